@@ -21,6 +21,8 @@ from esphome.const import (
     CONF_TYPE,
 )
 from esphome.core import CORE, TimePeriod
+from esphome.components.bthome_codec import BINARY_SENSOR_TYPES, SENSOR_TYPES
+from esphome.components.bthome_nimble import ROLE_BROADCASTER, request_nimble_host
 
 CODEOWNERS = ["@esphome/core"]
 
@@ -29,7 +31,7 @@ CODEOWNERS = ["@esphome/core"]
 DEPENDENCIES = []
 
 # Auto-load these components when bthome is used
-AUTO_LOAD = []
+AUTO_LOAD = ["bthome_codec", "bthome_nimble"]
 
 # BLE stack options for ESP32
 CONF_BLE_STACK = "ble_stack"
@@ -48,114 +50,6 @@ CONF_TRIGGER_BASED = "trigger_based"
 CONF_RETRANSMIT_COUNT = "retransmit_count"
 CONF_RETRANSMIT_INTERVAL = "retransmit_interval"
 
-# =============================================================================
-# BTHome v2 Sensor Object IDs
-# See: https://bthome.io/format/
-#
-# Format: "type_name": (object_id, data_bytes, signed, factor)
-#   - object_id: BTHome object identifier
-#   - data_bytes: number of bytes (1, 2, 3, or 4)
-#   - signed: True for signed integers, False for unsigned
-#   - factor: multiply raw value by this to get actual value
-# =============================================================================
-SENSOR_TYPES = {
-    # Basic sensors
-    "packet_id": (0x00, 1, False, 1),           # uint8, used for deduplication
-    "battery": (0x01, 1, False, 1),             # uint8, 1%
-    "temperature": (0x02, 2, True, 0.01),       # sint16, 0.01°C
-    "humidity": (0x03, 2, False, 0.01),         # uint16, 0.01%
-    "pressure": (0x04, 3, False, 0.01),         # uint24, 0.01 hPa
-    "illuminance": (0x05, 3, False, 0.01),      # uint24, 0.01 lux
-    "mass_kg": (0x06, 2, False, 0.01),          # uint16, 0.01 kg
-    "mass_lb": (0x07, 2, False, 0.01),          # uint16, 0.01 lb
-    "dewpoint": (0x08, 2, True, 0.01),          # sint16, 0.01°C
-    "count_uint8": (0x09, 1, False, 1),         # uint8
-    "energy": (0x0A, 3, False, 0.001),          # uint24, 0.001 kWh
-    "power": (0x0B, 3, False, 0.01),            # uint24, 0.01 W
-    "voltage": (0x0C, 2, False, 0.001),         # uint16, 0.001 V
-    "pm2_5": (0x0D, 2, False, 1),               # uint16, 1 µg/m³
-    "pm10": (0x0E, 2, False, 1),                # uint16, 1 µg/m³
-    "co2": (0x12, 2, False, 1),                 # uint16, 1 ppm
-    "tvoc": (0x13, 2, False, 1),                # uint16, 1 µg/m³
-    "moisture": (0x14, 2, False, 0.01),         # uint16, 0.01%
-    "humidity_uint8": (0x2E, 1, False, 1),      # uint8, 1%
-    "moisture_uint8": (0x2F, 1, False, 1),      # uint8, 1%
-
-    # Extended sensors
-    "count_uint16": (0x3D, 2, False, 1),        # uint16
-    "count_uint32": (0x3E, 4, False, 1),        # uint32
-    "rotation": (0x3F, 2, True, 0.1),           # sint16, 0.1°
-    "distance_mm": (0x40, 2, False, 1),         # uint16, 1 mm
-    "distance_m": (0x41, 2, False, 0.1),        # uint16, 0.1 m
-    "duration": (0x42, 3, False, 0.001),        # uint24, 0.001 s
-    "current": (0x43, 2, False, 0.001),         # uint16, 0.001 A
-    "speed": (0x44, 2, False, 0.01),            # uint16, 0.01 m/s
-    "temperature_01": (0x45, 2, True, 0.1),     # sint16, 0.1°C
-    "uv_index": (0x46, 1, False, 0.1),          # uint8, 0.1
-    "volume_l_01": (0x47, 2, False, 0.1),       # uint16, 0.1 L
-    "volume_ml": (0x48, 2, False, 1),           # uint16, 1 mL
-    "volume_flow_rate": (0x49, 2, False, 0.001),  # uint16, 0.001 m³/hr
-    "voltage_01": (0x4A, 2, False, 0.1),        # uint16, 0.1 V
-    "gas": (0x4B, 3, False, 0.001),             # uint24, 0.001 m³
-    "gas_uint32": (0x4C, 4, False, 0.001),      # uint32, 0.001 m³
-    "energy_uint32": (0x4D, 4, False, 0.001),   # uint32, 0.001 kWh
-    "volume_l": (0x4E, 4, False, 0.001),        # uint32, 0.001 L
-    "water": (0x4F, 4, False, 0.001),           # uint32, 0.001 L
-    "timestamp": (0x50, 4, False, 1),           # uint32, seconds since epoch
-    "acceleration": (0x51, 2, False, 0.001),    # uint16, 0.001 m/s²
-    "gyroscope": (0x52, 2, False, 0.001),       # uint16, 0.001 °/s
-    "volume_storage": (0x55, 4, False, 0.001),  # uint32, 0.001 L
-    "conductivity": (0x56, 2, False, 1),        # uint16, 1 µS/cm
-    "temperature_sint8": (0x57, 1, True, 1),    # sint8, 1°C
-    "temperature_sint8_035": (0x58, 1, True, 0.35),  # sint8, 0.35°C
-    "count_sint8": (0x59, 1, True, 1),          # sint8
-    "count_sint16": (0x5A, 2, True, 1),         # sint16
-    "count_sint32": (0x5B, 4, True, 1),         # sint32
-    "power_sint32": (0x5C, 4, True, 0.01),      # sint32, 0.01 W
-    "current_sint16": (0x5D, 2, True, 0.001),   # sint16, 0.001 A
-    "direction": (0x5E, 2, False, 0.01),        # uint16, 0.01°
-    "precipitation": (0x5F, 2, False, 0.1),     # uint16, 0.1 mm
-    "channel": (0x60, 1, False, 1),             # uint8
-    "rotational_speed": (0x61, 2, False, 1),    # uint16, 1 rpm
-}
-
-# =============================================================================
-# BTHome v2 Binary Sensor Object IDs
-# See: https://bthome.io/format/
-#
-# All binary sensors are uint8: 0x00 = off/false, 0x01 = on/true
-# =============================================================================
-BINARY_SENSOR_TYPES = {
-    "generic_boolean": 0x0F,    # generic on/off
-    "power": 0x10,              # power on/off
-    "opening": 0x11,            # open/closed
-    "battery_low": 0x15,        # battery normal/low
-    "battery_charging": 0x16,   # not charging/charging
-    "carbon_monoxide": 0x17,    # CO not detected/detected
-    "cold": 0x18,               # normal/cold
-    "connectivity": 0x19,       # disconnected/connected
-    "door": 0x1A,               # closed/open
-    "garage_door": 0x1B,        # closed/open
-    "gas": 0x1C,                # clear/detected
-    "heat": 0x1D,               # normal/hot
-    "light": 0x1E,              # no light/light detected
-    "lock": 0x1F,               # locked/unlocked
-    "moisture_binary": 0x20,    # dry/wet
-    "motion": 0x21,             # clear/detected
-    "moving": 0x22,             # not moving/moving
-    "occupancy": 0x23,          # clear/detected
-    "plug": 0x24,               # unplugged/plugged in
-    "presence": 0x25,           # away/home
-    "problem": 0x26,            # ok/problem
-    "running": 0x27,            # not running/running
-    "safety": 0x28,             # unsafe/safe
-    "smoke": 0x29,              # clear/detected
-    "sound": 0x2A,              # clear/detected
-    "tamper": 0x2B,             # off/on
-    "vibration": 0x2C,          # clear/detected
-    "window": 0x2D,             # closed/open
-}
-
 # TX Power levels for ESP32 (maps dBm to esp_power_level_t enum value)
 ESP32_TX_POWER_LEVELS = {
     -12: 0, -9: 1, -6: 2, -3: 3, 0: 4, 3: 5, 6: 6, 9: 7,
@@ -322,20 +216,10 @@ async def to_code(config):
         ble_stack = config.get(CONF_BLE_STACK, BLE_STACK_BLUEDROID)
 
         if ble_stack == BLE_STACK_NIMBLE:
-            # NimBLE stack - lighter weight (~170KB flash, ~100KB RAM savings)
+            # NimBLE stack - lighter weight (~170KB flash, ~100KB RAM savings).
+            # The host is shared with bthome_receiver, which adds the observer role if present.
             cg.add_define("USE_BTHOME_NIMBLE")
-            add_idf_sdkconfig_option("CONFIG_BT_ENABLED", True)
-            add_idf_sdkconfig_option("CONFIG_BT_NIMBLE_ENABLED", True)
-            add_idf_sdkconfig_option("CONFIG_BT_CONTROLLER_ENABLED", True)
-            # Disable Bluedroid
-            add_idf_sdkconfig_option("CONFIG_BT_BLUEDROID_ENABLED", False)
-            # NimBLE roles - only broadcaster needed for BTHome
-            add_idf_sdkconfig_option("CONFIG_BT_NIMBLE_ROLE_CENTRAL", False)
-            add_idf_sdkconfig_option("CONFIG_BT_NIMBLE_ROLE_OBSERVER", False)
-            add_idf_sdkconfig_option("CONFIG_BT_NIMBLE_ROLE_PERIPHERAL", False)
-            add_idf_sdkconfig_option("CONFIG_BT_NIMBLE_ROLE_BROADCASTER", True)
-            # Use tinycrypt for smaller footprint (saves ~7KB)
-            add_idf_sdkconfig_option("CONFIG_BT_NIMBLE_CRYPTO_STACK_MBEDTLS", False)
+            request_nimble_host(ROLE_BROADCASTER)
         else:
             # Bluedroid stack (default)
             cg.add_define("USE_BTHOME_BLUEDROID")
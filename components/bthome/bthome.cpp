@@ -10,13 +10,9 @@
 // Platform-specific includes
 #ifdef USE_ESP32
   #ifdef USE_BTHOME_NIMBLE
-    #include "esp_nimble_hci.h"
-    #include "nimble/nimble_port.h"
-    #include "nimble/nimble_port_freertos.h"
     #include "host/ble_hs.h"
     #include "host/util/util.h"
     #include <esp_bt.h>
-    #include <nvs_flash.h>
     // NimBLE uses tinycrypt for encryption
     #include "tinycrypt/ccm_mode.h"
     #include "tinycrypt/constants.h"
@@ -40,11 +36,6 @@ namespace bthome {
 
 static const char *const TAG = "bthome";
 
-#if defined(USE_ESP32) && defined(USE_BTHOME_NIMBLE)
-// Static instance for NimBLE callbacks
-BTHome *BTHome::instance_ = nullptr;
-#endif
-
 void BTHome::dump_config() {
   ESP_LOGCONFIG(TAG,
                 "BTHome:\n"
@@ -78,10 +69,10 @@ void BTHome::dump_config() {
     ESP_LOGCONFIG(TAG, "  Trigger-based: yes");
   }
 #ifdef USE_SENSOR
-  ESP_LOGCONFIG(TAG, "  Sensors: %d", this->measurements_.size());
+  ESP_LOGCONFIG(TAG, "  Sensors: %zu", this->measurements_.size());
 #endif
 #ifdef USE_BINARY_SENSOR
-  ESP_LOGCONFIG(TAG, "  Binary Sensors: %d", this->binary_measurements_.size());
+  ESP_LOGCONFIG(TAG, "  Binary Sensors: %zu", this->binary_measurements_.size());
 #endif
 }
 
@@ -98,39 +89,14 @@ void BTHome::setup() {
 
 #ifdef USE_ESP32
   #ifdef USE_BTHOME_NIMBLE
-  // NimBLE stack initialization
-  instance_ = this;
-
-  // Initialize NVS (required by NimBLE)
-  esp_err_t ret = nvs_flash_init();
-  if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
-    ESP_ERROR_CHECK(nvs_flash_erase());
-    ret = nvs_flash_init();
-  }
-  if (ret != ESP_OK) {
-    ESP_LOGE(TAG, "NVS flash init failed: %s", esp_err_to_name(ret));
-    this->mark_failed();
-    return;
-  }
-
-  // Initialize NimBLE
-  ret = nimble_port_init();
-  if (ret != ESP_OK) {
-    ESP_LOGE(TAG, "NimBLE port init failed: %s", esp_err_to_name(ret));
+  // NimBLE stack initialization, shared with bthome_receiver (which registers in its earlier setup())
+  // Note: Device name is included directly in advertisement data (build_advertisement_data_)
+  bthome_nimble::NimBLEHost::add_listener(this);
+  if (!bthome_nimble::NimBLEHost::start()) {
     this->mark_failed();
     return;
   }
-
-  // Configure NimBLE host callbacks
-  // Note: Device name is included directly in advertisement data (build_advertisement_data_)
-  ble_hs_cfg.sync_cb = nimble_on_sync_;
-  ble_hs_cfg.reset_cb = nimble_on_reset_;
-
-  // Start NimBLE host task
-  nimble_port_freertos_init(nimble_host_task_);
-
   ESP_LOGD(TAG, "NimBLE initialized, waiting for sync...");
-  this->nimble_initialized_ = true;
 
   #else
   // Bluedroid stack initialization
@@ -148,6 +114,9 @@ void BTHome::setup() {
   global_ble->advertising_register_raw_advertisement_callback([this](bool advertise) {
     this->advertising_ = advertise;
     if (advertise) {
+      if (this->encryption_enabled_ && !this->nonce_prefix_valid_) {
+        this->update_nonce_prefix_();
+      }
       this->build_advertisement_data_();
       this->build_scan_response_data_();
       this->start_advertising_();
@@ -167,6 +136,10 @@ void BTHome::setup() {
 
   ESP_LOGD(TAG, "Bluetooth initialized");
 
+  if (this->encryption_enabled_) {
+    this->update_nonce_prefix_();
+  }
+
   // Set up advertising parameters
   this->adv_param_ = BT_LE_ADV_PARAM_INIT(
       BT_LE_ADV_OPT_USE_IDENTITY,
@@ -289,14 +262,33 @@ void BTHome::loop() {
 }
 
 void BTHome::set_encryption_key(const std::array<uint8_t, 16> &key) {
+  // The key never changes, so expand it once here instead of on every packet
+#if defined(USE_ESP32) && defined(USE_BTHOME_BLUEDROID)
+  if (this->encryption_enabled_) {
+    mbedtls_ccm_free(&this->ccm_ctx_);
+  }
+  mbedtls_ccm_init(&this->ccm_ctx_);
+  int ret = mbedtls_ccm_setkey(&this->ccm_ctx_, MBEDTLS_CIPHER_ID_AES, key.data(), 128);
+  if (ret != 0) {
+    ESP_LOGE(TAG, "mbedtls_ccm_setkey failed: %d", ret);
+    mbedtls_ccm_free(&this->ccm_ctx_);
+    this->encryption_enabled_ = false;
+    return;
+  }
+#else
+  if (tc_aes128_set_encrypt_key(&this->key_sched_, key.data()) != TC_CRYPTO_SUCCESS) {
+    ESP_LOGE(TAG, "Failed to set AES key");
+    this->encryption_enabled_ = false;
+    return;
+  }
+#endif
   this->encryption_enabled_ = true;
-  this->encryption_key_ = key;
 }
 
 void BTHome::set_device_name(const std::string &name) {
   if (name.length() > MAX_DEVICE_NAME_LENGTH) {
     this->device_name_ = name.substr(0, MAX_DEVICE_NAME_LENGTH);
-    ESP_LOGW(TAG, "Device name truncated to %d characters", MAX_DEVICE_NAME_LENGTH);
+    ESP_LOGW(TAG, "Device name truncated to %zu characters", MAX_DEVICE_NAME_LENGTH);
   } else {
     this->device_name_ = name;
   }
@@ -338,8 +330,8 @@ void BTHome::build_advertisement_data_() {
   this->adv_data_[pos++] = 0x16;  // Type: Service Data
 
   // BTHome Service UUID (little-endian)
-  this->adv_data_[pos++] = BTHOME_SERVICE_UUID & 0xFF;
-  this->adv_data_[pos++] = (BTHOME_SERVICE_UUID >> 8) & 0xFF;
+  this->adv_data_[pos++] = bthome_codec::SERVICE_UUID & 0xFF;
+  this->adv_data_[pos++] = (bthome_codec::SERVICE_UUID >> 8) & 0xFF;
 
   // Device info byte: combines encryption (bit 0) and trigger-based (bit 2) flags
   uint8_t device_info;
@@ -351,6 +343,8 @@ void BTHome::build_advertisement_data_() {
   this->adv_data_[pos++] = device_info;
 
   size_t measurement_start = pos;
+  // Measurements must leave room for the counter and MIC that encryption appends
+  const size_t measurement_end = MAX_BLE_ADVERTISEMENT_SIZE - (this->encryption_enabled_ ? ENCRYPTION_OVERHEAD : 0);
 
   // Packet ID (object 0x00) - helps receivers deduplicate retransmissions
   // Only incremented when build_advertisement_data_() is called (new data)
@@ -364,7 +358,7 @@ void BTHome::build_advertisement_data_() {
     if (this->immediate_adv_is_binary_) {
       auto &measurement = this->binary_measurements_[this->immediate_adv_measurement_index_];
       if (measurement.sensor->has_state()) {
-        pos += this->encode_binary_measurement_(this->adv_data_ + pos, MAX_BLE_ADVERTISEMENT_SIZE - pos,
+        pos += this->encode_binary_measurement_(this->adv_data_ + pos, measurement_end - pos,
                                                  measurement.object_id, measurement.sensor->state);
       }
     }
@@ -373,7 +367,7 @@ void BTHome::build_advertisement_data_() {
     if (!this->immediate_adv_is_binary_) {
       auto &measurement = this->measurements_[this->immediate_adv_measurement_index_];
       if (measurement.sensor->has_state() && !std::isnan(measurement.sensor->state)) {
-        pos += this->encode_measurement_(this->adv_data_ + pos, MAX_BLE_ADVERTISEMENT_SIZE - pos, measurement);
+        pos += this->encode_measurement_(this->adv_data_ + pos, measurement_end - pos, measurement);
       }
     }
 #endif
@@ -395,10 +389,10 @@ void BTHome::build_advertisement_data_() {
 
         // Check if measurement fits: object_id (1 byte) + data_bytes
         size_t encoded_size = 1 + measurement.data_bytes;
-        if (pos + encoded_size > MAX_BLE_ADVERTISEMENT_SIZE)
+        if (pos + encoded_size > measurement_end)
           break;
 
-        pos += this->encode_measurement_(this->adv_data_ + pos, MAX_BLE_ADVERTISEMENT_SIZE - pos, measurement);
+        pos += this->encode_measurement_(this->adv_data_ + pos, measurement_end - pos, measurement);
         added++;
       }
 
@@ -423,10 +417,10 @@ void BTHome::build_advertisement_data_() {
         if (!measurement.sensor->has_state())
           continue;
 
-        if (pos + 2 > MAX_BLE_ADVERTISEMENT_SIZE)
+        if (pos + 2 > measurement_end)
           break;
 
-        pos += this->encode_binary_measurement_(this->adv_data_ + pos, MAX_BLE_ADVERTISEMENT_SIZE - pos,
+        pos += this->encode_binary_measurement_(this->adv_data_ + pos, measurement_end - pos,
                                                  measurement.object_id, measurement.sensor->state);
         added++;
       }
@@ -450,15 +444,18 @@ void BTHome::build_advertisement_data_() {
     size_t ciphertext_len = 0;
 
     if (this->encrypt_payload_(plaintext, measurement_len, ciphertext, &ciphertext_len)) {
-      memcpy(this->adv_data_ + measurement_start, ciphertext, ciphertext_len);
-      pos = measurement_start + ciphertext_len;
+      // BTHome v2 order: ciphertext, counter (4 bytes, little-endian), MIC (4 bytes)
+      memcpy(this->adv_data_ + measurement_start, ciphertext, measurement_len);
+      pos = measurement_start + measurement_len;
 
-      // Add counter (4 bytes, little-endian)
       this->adv_data_[pos++] = this->counter_ & 0xFF;
       this->adv_data_[pos++] = (this->counter_ >> 8) & 0xFF;
       this->adv_data_[pos++] = (this->counter_ >> 16) & 0xFF;
       this->adv_data_[pos++] = (this->counter_ >> 24) & 0xFF;
 
+      memcpy(this->adv_data_ + pos, ciphertext + measurement_len, ciphertext_len - measurement_len);
+      pos += ciphertext_len - measurement_len;
+
       this->counter_++;
     }
   }
@@ -534,8 +531,8 @@ void BTHome::start_advertising_() {
 #ifdef USE_ESP32
   #ifdef USE_BTHOME_NIMBLE
   // NimBLE advertising
-  if (!this->nimble_initialized_) {
-    ESP_LOGW(TAG, "NimBLE not initialized yet");
+  if (!bthome_nimble::NimBLEHost::is_synced()) {
+    ESP_LOGW(TAG, "NimBLE not synced yet");
     return;
   }
 
@@ -572,6 +569,7 @@ void BTHome::start_advertising_() {
   }
 
   this->advertising_ = true;
+  bthome_nimble::NimBLEHost::set_advertising(true);
   ESP_LOGD(TAG, "NimBLE advertising started");
 
   #else
@@ -627,7 +625,7 @@ void BTHome::start_advertising_() {
   size_t sd_count = 0;
 
   // Add BTHome service UUID to scan response
-  static uint8_t svc_uuid_data[] = {BTHOME_SERVICE_UUID & 0xFF, (BTHOME_SERVICE_UUID >> 8) & 0xFF};
+  static uint8_t svc_uuid_data[] = {bthome_codec::SERVICE_UUID & 0xFF, (bthome_codec::SERVICE_UUID >> 8) & 0xFF};
   this->sd_[sd_count].type = BT_DATA_UUID16_ALL;
   this->sd_[sd_count].data_len = sizeof(svc_uuid_data);
   this->sd_[sd_count].data = svc_uuid_data;
@@ -689,6 +687,7 @@ void BTHome::stop_advertising_() {
   if (this->advertising_) {
     ble_gap_adv_stop();
     this->advertising_ = false;
+    bthome_nimble::NimBLEHost::set_advertising(false);
   }
   #else
   if (this->advertising_) {
@@ -706,32 +705,30 @@ void BTHome::stop_advertising_() {
 }
 
 #if defined(USE_ESP32) && defined(USE_BTHOME_NIMBLE)
-// NimBLE static callbacks
-void BTHome::nimble_host_task_(void *param) {
-  ESP_LOGD(TAG, "NimBLE host task started");
-  nimble_port_run();
-  nimble_port_freertos_deinit();
-}
-
-void BTHome::nimble_on_sync_() {
-  ESP_LOGD(TAG, "NimBLE host synced");
-
+// NimBLE host callbacks
+void BTHome::on_host_sync() {
   // Determine address type
-  int rc = ble_hs_id_infer_auto(0, &instance_->nimble_own_addr_type_);
+  int rc = ble_hs_id_infer_auto(0, &this->nimble_own_addr_type_);
   if (rc != 0) {
     ESP_LOGE(TAG, "Failed to infer address type: %d", rc);
     return;
   }
 
+  // The identity address is known now; cache it for the encryption nonce
+  this->nonce_prefix_valid_ = false;
+  if (this->encryption_enabled_) {
+    this->update_nonce_prefix_();
+  }
+
   // Build and start advertising
-  instance_->build_advertisement_data_();
-  instance_->build_scan_response_data_();
-  instance_->start_advertising_();
+  this->build_advertisement_data_();
+  this->build_scan_response_data_();
+  this->start_advertising_();
 }
 
-void BTHome::nimble_on_reset_(int reason) {
-  ESP_LOGW(TAG, "NimBLE host reset, reason: %d", reason);
-  instance_->advertising_ = false;
+void BTHome::on_host_reset(int reason) {
+  // The host stopped advertising; the shared host logs the reason and clears its advertising flag
+  this->advertising_ = false;
 }
 #endif
 
@@ -744,158 +741,36 @@ void BTHome::gap_event_handler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_para
 
 #ifdef USE_SENSOR
 size_t BTHome::encode_measurement_(uint8_t *data, size_t max_len, const SensorMeasurement &measurement) {
-  // Generic BTHome v2 sensor encoding
-  // Uses data_bytes, is_signed, and factor from the measurement struct
+  // Generic BTHome v2 sensor encoding: object_id + little-endian value / factor
   // See: https://bthome.io/format/
-
-  size_t required_size = 1 + measurement.data_bytes;  // object_id + value bytes
-  if (max_len < required_size) {
-    return 0;
-  }
-
-  float value = measurement.sensor->state;
-  size_t pos = 0;
-
-  // Object ID
-  data[pos++] = measurement.object_id;
-
-  // Convert value to encoded integer using factor
-  // Factor in Python is the resolution (e.g., 0.01 means value * 100)
-  // So we divide by factor to get the encoded value
-  double scaled = std::round(value / measurement.factor);
-
-  // Encode based on data_bytes and signedness (little-endian)
-  if (measurement.is_signed) {
-    // Signed integer encoding
-    int32_t encoded;
-    switch (measurement.data_bytes) {
-      case 1:
-        encoded = static_cast<int8_t>(std::max(-128.0, std::min(127.0, scaled)));
-        data[pos++] = encoded & 0xFF;
-        break;
-      case 2:
-        encoded = static_cast<int16_t>(std::max(-32768.0, std::min(32767.0, scaled)));
-        data[pos++] = encoded & 0xFF;
-        data[pos++] = (encoded >> 8) & 0xFF;
-        break;
-      case 3:
-        // sint24 - range: -8388608 to 8388607
-        encoded = static_cast<int32_t>(std::max(-8388608.0, std::min(8388607.0, scaled)));
-        data[pos++] = encoded & 0xFF;
-        data[pos++] = (encoded >> 8) & 0xFF;
-        data[pos++] = (encoded >> 16) & 0xFF;
-        break;
-      case 4:
-        encoded = static_cast<int32_t>(scaled);
-        data[pos++] = encoded & 0xFF;
-        data[pos++] = (encoded >> 8) & 0xFF;
-        data[pos++] = (encoded >> 16) & 0xFF;
-        data[pos++] = (encoded >> 24) & 0xFF;
-        break;
-      default:
-        ESP_LOGW(TAG, "Unsupported data_bytes: %d for object 0x%02X", measurement.data_bytes, measurement.object_id);
-        return 0;
-    }
-  } else {
-    // Unsigned integer encoding
-    uint32_t encoded;
-    switch (measurement.data_bytes) {
-      case 1:
-        encoded = static_cast<uint8_t>(std::max(0.0, std::min(255.0, scaled)));
-        data[pos++] = encoded & 0xFF;
-        break;
-      case 2:
-        encoded = static_cast<uint16_t>(std::max(0.0, std::min(65535.0, scaled)));
-        data[pos++] = encoded & 0xFF;
-        data[pos++] = (encoded >> 8) & 0xFF;
-        break;
-      case 3:
-        // uint24 - range: 0 to 16777215
-        encoded = static_cast<uint32_t>(std::max(0.0, std::min(16777215.0, scaled)));
-        data[pos++] = encoded & 0xFF;
-        data[pos++] = (encoded >> 8) & 0xFF;
-        data[pos++] = (encoded >> 16) & 0xFF;
-        break;
-      case 4:
-        encoded = static_cast<uint32_t>(std::max(0.0, scaled));
-        data[pos++] = encoded & 0xFF;
-        data[pos++] = (encoded >> 8) & 0xFF;
-        data[pos++] = (encoded >> 16) & 0xFF;
-        data[pos++] = (encoded >> 24) & 0xFF;
-        break;
-      default:
-        ESP_LOGW(TAG, "Unsupported data_bytes: %d for object 0x%02X", measurement.data_bytes, measurement.object_id);
-        return 0;
-    }
-  }
-
-  return pos;
+  return bthome_codec::encode_value(data, max_len, measurement.object_id, measurement.sensor->state,
+                                    measurement.data_bytes, measurement.is_signed, measurement.factor);
 }
 #endif
 
 #ifdef USE_BINARY_SENSOR
 size_t BTHome::encode_binary_measurement_(uint8_t *data, size_t max_len, uint8_t object_id, bool value) {
   // Binary sensors are always encoded as: [object_id] [0x00 or 0x01]
-  // See: https://bthome.io/format/
-  //
-  // BTHome v2 binary sensor object IDs:
-  //   0x0F - generic_boolean (generic on/off)
-  //   0x10 - power (power on/off)
-  //   0x11 - opening (open/closed)
-  //   0x15 - battery_low (battery normal/low)
-  //   0x16 - battery_charging (not charging/charging)
-  //   0x17 - carbon_monoxide (CO not detected/detected)
-  //   0x18 - cold (normal/cold)
-  //   0x19 - connectivity (disconnected/connected)
-  //   0x1A - door (closed/open)
-  //   0x1B - garage_door (closed/open)
-  //   0x1C - gas (clear/detected)
-  //   0x1D - heat (normal/hot)
-  //   0x1E - light (no light/light detected)
-  //   0x1F - lock (locked/unlocked)
-  //   0x20 - moisture_binary (dry/wet)
-  //   0x21 - motion (clear/detected)
-  //   0x22 - moving (not moving/moving)
-  //   0x23 - occupancy (clear/detected)
-  //   0x24 - plug (unplugged/plugged in)
-  //   0x25 - presence (away/home)
-  //   0x26 - problem (ok/problem)
-  //   0x27 - running (not running/running)
-  //   0x28 - safety (unsafe/safe)
-  //   0x29 - smoke (clear/detected)
-  //   0x2A - sound (clear/detected)
-  //   0x2B - tamper (off/on)
-  //   0x2C - vibration (clear/detected)
-  //   0x2D - window (closed/open)
-
-  if (max_len < 2) return 0;
-
-  data[0] = object_id;
-  data[1] = value ? 0x01 : 0x00;
-  return 2;
+  return bthome_codec::encode_binary(data, max_len, object_id, value);
 }
 #endif
 
-bool BTHome::encrypt_payload_(const uint8_t *plaintext, size_t plaintext_len, uint8_t *ciphertext, size_t *ciphertext_len) {
-  if (!this->encryption_enabled_) return false;
-
-  // Build nonce: MAC (6) + UUID (2) + device info (1) + counter (4) = 13 bytes
-  uint8_t nonce[13];
-
+bool BTHome::update_nonce_prefix_() {
+  // Nonce prefix: MAC (6) + UUID (2); the MAC only changes if the stack resets
 #ifdef USE_ESP32
   #ifdef USE_BTHOME_NIMBLE
-  // NimBLE: Get MAC address from controller
-  uint8_t mac[6];
-  int rc = ble_hs_id_copy_addr(this->nimble_own_addr_type_, mac, nullptr);
+  int rc = ble_hs_id_copy_addr(this->nimble_own_addr_type_, this->nonce_prefix_, nullptr);
   if (rc != 0) {
     ESP_LOGE(TAG, "Failed to get NimBLE MAC address: %d", rc);
     return false;
   }
-  memcpy(nonce, mac, 6);
   #else
-  // Bluedroid: Get MAC address
   const uint8_t *mac = esp_bt_dev_get_address();
-  memcpy(nonce, mac, 6);
+  if (mac == nullptr) {
+    ESP_LOGE(TAG, "Failed to get Bluetooth MAC address");
+    return false;
+  }
+  memcpy(this->nonce_prefix_, mac, 6);
   #endif
 #endif
 
@@ -903,71 +778,40 @@ bool BTHome::encrypt_payload_(const uint8_t *plaintext, size_t plaintext_len, ui
   bt_addr_le_t addr;
   size_t count = 1;
   bt_id_get(&addr, &count);
-  memcpy(nonce, addr.a.val, 6);
+  memcpy(this->nonce_prefix_, addr.a.val, 6);
 #endif
 
-  nonce[6] = BTHOME_SERVICE_UUID & 0xFF;
-  nonce[7] = (BTHOME_SERVICE_UUID >> 8) & 0xFF;
+  this->nonce_prefix_[6] = bthome_codec::SERVICE_UUID & 0xFF;
+  this->nonce_prefix_[7] = (bthome_codec::SERVICE_UUID >> 8) & 0xFF;
+  this->nonce_prefix_valid_ = true;
+  return true;
+}
+
+bool BTHome::encrypt_payload_(const uint8_t *plaintext, size_t plaintext_len, uint8_t *ciphertext, size_t *ciphertext_len) {
+  if (!this->encryption_enabled_) return false;
+  if (!this->nonce_prefix_valid_ && !this->update_nonce_prefix_()) return false;
+
+  // Build nonce: MAC (6) + UUID (2) + device info (1) + counter (4) = 13 bytes
+  uint8_t nonce[13];
+  memcpy(nonce, this->nonce_prefix_, sizeof(this->nonce_prefix_));
   nonce[8] = this->trigger_based_ ? BTHOME_DEVICE_INFO_TRIGGER_ENCRYPTED : BTHOME_DEVICE_INFO_ENCRYPTED;
   nonce[9] = this->counter_ & 0xFF;
   nonce[10] = (this->counter_ >> 8) & 0xFF;
   nonce[11] = (this->counter_ >> 16) & 0xFF;
   nonce[12] = (this->counter_ >> 24) & 0xFF;
 
-#ifdef USE_ESP32
-  #ifdef USE_BTHOME_NIMBLE
-  // NimBLE: Use tinycrypt for encryption (smaller footprint)
-  struct tc_ccm_mode_struct ctx;
-  struct tc_aes_key_sched_struct sched;
-
-  if (tc_aes128_set_encrypt_key(&sched, this->encryption_key_.data()) != TC_CRYPTO_SUCCESS) {
-    ESP_LOGE(TAG, "Failed to set AES key");
-    return false;
-  }
-
-  if (tc_ccm_config(&ctx, &sched, nonce, sizeof(nonce), 4) != TC_CRYPTO_SUCCESS) {
-    ESP_LOGE(TAG, "Failed to configure CCM");
-    return false;
-  }
-
-  if (tc_ccm_generation_encryption(ciphertext, plaintext_len + 4, nullptr, 0,
-                                    plaintext, plaintext_len, &ctx) != TC_CRYPTO_SUCCESS) {
-    ESP_LOGE(TAG, "CCM encryption failed");
-    return false;
-  }
-  #else
-  // Bluedroid: Use mbedtls for encryption
-  mbedtls_ccm_context ctx;
-  mbedtls_ccm_init(&ctx);
-
-  int ret = mbedtls_ccm_setkey(&ctx, MBEDTLS_CIPHER_ID_AES, this->encryption_key_.data(), 128);
-  if (ret != 0) {
-    ESP_LOGE(TAG, "mbedtls_ccm_setkey failed: %d", ret);
-    mbedtls_ccm_free(&ctx);
-    return false;
-  }
-
-  ret = mbedtls_ccm_encrypt_and_tag(&ctx, plaintext_len, nonce, sizeof(nonce), nullptr, 0,
-                                     plaintext, ciphertext, ciphertext + plaintext_len, 4);
-  mbedtls_ccm_free(&ctx);
-
+#if defined(USE_ESP32) && defined(USE_BTHOME_BLUEDROID)
+  // Bluedroid: Use mbedtls with the cached CCM context
+  int ret = mbedtls_ccm_encrypt_and_tag(&this->ccm_ctx_, plaintext_len, nonce, sizeof(nonce), nullptr, 0,
+                                        plaintext, ciphertext, ciphertext + plaintext_len, 4);
   if (ret != 0) {
     ESP_LOGE(TAG, "mbedtls_ccm_encrypt_and_tag failed: %d", ret);
     return false;
   }
-  #endif
-#endif
-
-#ifdef USE_NRF52
+#else
+  // NimBLE / nRF52: Use tinycrypt with the cached key schedule (smaller footprint)
   struct tc_ccm_mode_struct ctx;
-  struct tc_aes_key_sched_struct sched;
-
-  if (tc_aes128_set_encrypt_key(&sched, this->encryption_key_.data()) != TC_CRYPTO_SUCCESS) {
-    ESP_LOGE(TAG, "Failed to set AES key");
-    return false;
-  }
-
-  if (tc_ccm_config(&ctx, &sched, nonce, sizeof(nonce), 4) != TC_CRYPTO_SUCCESS) {
+  if (tc_ccm_config(&ctx, &this->key_sched_, nonce, sizeof(nonce), 4) != TC_CRYPTO_SUCCESS) {
     ESP_LOGE(TAG, "Failed to configure CCM");
     return false;
   }
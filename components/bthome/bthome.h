@@ -3,6 +3,7 @@
 #include "esphome/core/defines.h"
 #include "esphome/core/component.h"
 #include "esphome/core/helpers.h"
+#include "esphome/components/bthome_codec/bthome_codec.h"
 #ifdef USE_SENSOR
 #include "esphome/components/sensor/sensor.h"
 #endif
@@ -16,13 +17,12 @@
 #ifdef USE_ESP32
   #include <esp_timer.h>  // For esp_timer_get_time()
   #ifdef USE_BTHOME_NIMBLE
-    // NimBLE stack (lighter weight, broadcast-only)
-    #include "esp_nimble_hci.h"
-    #include "nimble/nimble_port.h"
-    #include "nimble/nimble_port_freertos.h"
+    // NimBLE stack (lighter weight), host shared with bthome_receiver
+    #include "esphome/components/bthome_nimble/nimble_host.h"
     #include "host/ble_hs.h"
     #include "host/util/util.h"
     #include <esp_bt.h>
+    #include "tinycrypt/aes.h"
   #else
     // Bluedroid stack (default)
     #include "esphome/components/esp32_ble/ble.h"
@@ -30,12 +30,14 @@
       #include <esp_bt.h>
     #endif
     #include <esp_gap_ble_api.h>
+    #include "mbedtls/ccm.h"
   #endif
 #endif  // USE_ESP32
 
 #ifdef USE_NRF52
 #include <zephyr/bluetooth/bluetooth.h>
 #include <zephyr/bluetooth/hci.h>
+#include <tinycrypt/aes.h>
 #endif  // USE_NRF52
 
 #if defined(USE_ESP32) || defined(USE_NRF52)
@@ -43,14 +45,14 @@
 namespace esphome {
 namespace bthome {
 
-// BTHome v2 constants
-static const uint16_t BTHOME_SERVICE_UUID = 0xFCD2;
+// BTHome v2 constants (the service UUID is bthome_codec::SERVICE_UUID)
 // Device info byte format: bit 0 = encryption, bit 2 = trigger-based
 static const uint8_t BTHOME_DEVICE_INFO_UNENCRYPTED = 0x40;           // Regular device, no encryption
 static const uint8_t BTHOME_DEVICE_INFO_ENCRYPTED = 0x41;             // Regular device, encrypted
 static const uint8_t BTHOME_DEVICE_INFO_TRIGGER_UNENCRYPTED = 0x44;   // Trigger-based device, no encryption
 static const uint8_t BTHOME_DEVICE_INFO_TRIGGER_ENCRYPTED = 0x45;     // Trigger-based device, encrypted
 static const size_t MAX_BLE_ADVERTISEMENT_SIZE = 31;
+static const size_t ENCRYPTION_OVERHEAD = 8;  // Counter (4) + MIC (4) after the ciphertext
 static const size_t MAX_DEVICE_NAME_LENGTH = 20;  // Leave room for other AD elements
 
 #ifdef USE_SENSOR
@@ -76,6 +78,8 @@ struct BinarySensorMeasurement {
 using namespace esp32_ble;
 
 class BTHome : public Component, public GAPEventHandler, public Parented<ESP32BLE> {
+#elif defined(USE_ESP32) && defined(USE_BTHOME_NIMBLE)
+class BTHome : public Component, public bthome_nimble::NimBLEHostListener {
 #else
 class BTHome : public Component {
 #endif
@@ -85,6 +89,12 @@ class BTHome : public Component {
   void loop() override;
   float get_setup_priority() const override;
 
+#if defined(USE_ESP32) && defined(USE_BTHOME_NIMBLE)
+  // NimBLEHostListener interface (NimBLE host task)
+  void on_host_sync() override;
+  void on_host_reset(int reason) override;
+#endif
+
   void set_min_interval(uint16_t val) { this->min_interval_ = val; }
   void set_max_interval(uint16_t val) { this->max_interval_ = val; }
   void set_retransmit_count(uint8_t count) { this->retransmit_count_ = count; }
@@ -126,6 +136,7 @@ class BTHome : public Component {
   size_t encode_binary_measurement_(uint8_t *data, size_t max_len, uint8_t object_id, bool value);
 #endif
   bool encrypt_payload_(const uint8_t *plaintext, size_t plaintext_len, uint8_t *ciphertext, size_t *ciphertext_len);
+  bool update_nonce_prefix_();
   void trigger_immediate_advertising_(uint8_t measurement_index, bool is_binary);
 
   // Measurements storage
@@ -155,8 +166,16 @@ class BTHome : public Component {
 
   // Encryption
   bool encryption_enabled_{false};
-  std::array<uint8_t, 16> encryption_key_{};
   uint32_t counter_{0};
+  // Constant nonce prefix: own MAC(6) + UUID(2), read from the stack once it is ready
+  uint8_t nonce_prefix_[8]{};
+  bool nonce_prefix_valid_{false};
+  // Expanded AES key, computed once in set_encryption_key()
+#if defined(USE_ESP32) && defined(USE_BTHOME_BLUEDROID)
+  mbedtls_ccm_context ccm_ctx_;
+#else
+  struct tc_aes_key_sched_struct key_sched_;
+#endif
 
   // Packet ID for deduplication (increments only when data changes, not on retransmits)
   uint8_t packet_id_{0};
@@ -186,11 +205,6 @@ class BTHome : public Component {
   #ifdef USE_BTHOME_NIMBLE
     // NimBLE-specific members
     uint8_t nimble_own_addr_type_{0};
-    bool nimble_initialized_{false};
-    static BTHome *instance_;  // For NimBLE callbacks
-    static void nimble_host_task_(void *param);
-    static void nimble_on_sync_();
-    static void nimble_on_reset_(int reason);
   #else
     // Bluedroid-specific members
     esp_ble_adv_params_t ble_adv_params_;
@@ -0,0 +1,318 @@
+#pragma once
+
+// BTHome v2 object encoding and decoding, shared by the bthome broadcaster and bthome_receiver.
+// Header-only and free of ESPHome/ESP-IDF dependencies, so it also builds with a host compiler.
+// See: https://bthome.io/format/
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+namespace esphome {
+namespace bthome_codec {
+
+// BTHome service UUID, carried in an AD type 0x16 (Service Data - 16-bit UUID) structure
+static const uint16_t SERVICE_UUID = 0xFCD2;
+static const uint8_t AD_TYPE_SERVICE_DATA_16 = 0x16;
+
+// Special object IDs for packet IDs, events and variable-length data
+static const uint8_t OBJECT_ID_PACKET_ID = 0x00;
+static const uint8_t OBJECT_ID_BUTTON = 0x3A;
+static const uint8_t OBJECT_ID_DIMMER = 0x3C;
+static const uint8_t OBJECT_ID_TEXT = 0x53;
+static const uint8_t OBJECT_ID_RAW = 0x54;
+
+// Object kinds, used to pick the decoding branch for an object ID
+enum ObjectKind : uint8_t {
+  OBJECT_KIND_UNKNOWN = 0,   // Not defined by BTHome v2 (size unknown, parsing must stop)
+  OBJECT_KIND_SENSOR,        // Numeric value: data_bytes little-endian integer * factor
+  OBJECT_KIND_BINARY_SENSOR, // Single byte, 0x00 = off, 0x01 = on
+  OBJECT_KIND_EVENT,         // Button/dimmer event: single byte payload
+  OBJECT_KIND_VARIABLE,      // Text/raw: length byte followed by data
+};
+
+// Object type info for encoding and decoding BTHome data
+struct ObjectTypeInfo {
+  uint8_t data_bytes;
+  bool is_signed;
+  ObjectKind kind;
+  float factor;
+  const char *name;  // Human-readable name (for dump mode)
+};
+
+struct ObjectTypeEntry {
+  uint8_t object_id;
+  ObjectTypeInfo info;
+};
+
+// BTHome v2 object type definitions
+// Format: object_id -> (data_bytes, is_signed, kind, factor, name)
+static constexpr ObjectTypeEntry OBJECT_TYPE_ENTRIES[] = {
+    // Basic sensors
+    {0x00, {1, false, OBJECT_KIND_SENSOR, 1.0f, "packet_id"}},
+    {0x01, {1, false, OBJECT_KIND_SENSOR, 1.0f, "battery"}},
+    {0x02, {2, true, OBJECT_KIND_SENSOR, 0.01f, "temperature"}},
+    {0x03, {2, false, OBJECT_KIND_SENSOR, 0.01f, "humidity"}},
+    {0x04, {3, false, OBJECT_KIND_SENSOR, 0.01f, "pressure"}},
+    {0x05, {3, false, OBJECT_KIND_SENSOR, 0.01f, "illuminance"}},
+    {0x06, {2, false, OBJECT_KIND_SENSOR, 0.01f, "mass_kg"}},
+    {0x07, {2, false, OBJECT_KIND_SENSOR, 0.01f, "mass_lb"}},
+    {0x08, {2, true, OBJECT_KIND_SENSOR, 0.01f, "dewpoint"}},
+    {0x09, {1, false, OBJECT_KIND_SENSOR, 1.0f, "count"}},
+    {0x0A, {3, false, OBJECT_KIND_SENSOR, 0.001f, "energy"}},
+    {0x0B, {3, false, OBJECT_KIND_SENSOR, 0.01f, "power"}},
+    {0x0C, {2, false, OBJECT_KIND_SENSOR, 0.001f, "voltage"}},
+    {0x0D, {2, false, OBJECT_KIND_SENSOR, 1.0f, "pm2_5"}},
+    {0x0E, {2, false, OBJECT_KIND_SENSOR, 1.0f, "pm10"}},
+    {0x12, {2, false, OBJECT_KIND_SENSOR, 1.0f, "co2"}},
+    {0x13, {2, false, OBJECT_KIND_SENSOR, 1.0f, "tvoc"}},
+    {0x14, {2, false, OBJECT_KIND_SENSOR, 0.01f, "moisture"}},
+    {0x2E, {1, false, OBJECT_KIND_SENSOR, 1.0f, "humidity_uint8"}},
+    {0x2F, {1, false, OBJECT_KIND_SENSOR, 1.0f, "moisture_uint8"}},
+
+    // Binary sensors
+    {0x0F, {1, false, OBJECT_KIND_BINARY_SENSOR, 1.0f, "generic_boolean"}},
+    {0x10, {1, false, OBJECT_KIND_BINARY_SENSOR, 1.0f, "power_binary"}},
+    {0x11, {1, false, OBJECT_KIND_BINARY_SENSOR, 1.0f, "opening"}},
+    {0x15, {1, false, OBJECT_KIND_BINARY_SENSOR, 1.0f, "battery_low"}},
+    {0x16, {1, false, OBJECT_KIND_BINARY_SENSOR, 1.0f, "battery_charging"}},
+    {0x17, {1, false, OBJECT_KIND_BINARY_SENSOR, 1.0f, "carbon_monoxide"}},
+    {0x18, {1, false, OBJECT_KIND_BINARY_SENSOR, 1.0f, "cold"}},
+    {0x19, {1, false, OBJECT_KIND_BINARY_SENSOR, 1.0f, "connectivity"}},
+    {0x1A, {1, false, OBJECT_KIND_BINARY_SENSOR, 1.0f, "door"}},
+    {0x1B, {1, false, OBJECT_KIND_BINARY_SENSOR, 1.0f, "garage_door"}},
+    {0x1C, {1, false, OBJECT_KIND_BINARY_SENSOR, 1.0f, "gas"}},
+    {0x1D, {1, false, OBJECT_KIND_BINARY_SENSOR, 1.0f, "heat"}},
+    {0x1E, {1, false, OBJECT_KIND_BINARY_SENSOR, 1.0f, "light"}},
+    {0x1F, {1, false, OBJECT_KIND_BINARY_SENSOR, 1.0f, "lock"}},
+    {0x20, {1, false, OBJECT_KIND_BINARY_SENSOR, 1.0f, "moisture_binary"}},
+    {0x21, {1, false, OBJECT_KIND_BINARY_SENSOR, 1.0f, "motion"}},
+    {0x22, {1, false, OBJECT_KIND_BINARY_SENSOR, 1.0f, "moving"}},
+    {0x23, {1, false, OBJECT_KIND_BINARY_SENSOR, 1.0f, "occupancy"}},
+    {0x24, {1, false, OBJECT_KIND_BINARY_SENSOR, 1.0f, "plug"}},
+    {0x25, {1, false, OBJECT_KIND_BINARY_SENSOR, 1.0f, "presence"}},
+    {0x26, {1, false, OBJECT_KIND_BINARY_SENSOR, 1.0f, "problem"}},
+    {0x27, {1, false, OBJECT_KIND_BINARY_SENSOR, 1.0f, "running"}},
+    {0x28, {1, false, OBJECT_KIND_BINARY_SENSOR, 1.0f, "safety"}},
+    {0x29, {1, false, OBJECT_KIND_BINARY_SENSOR, 1.0f, "smoke"}},
+    {0x2A, {1, false, OBJECT_KIND_BINARY_SENSOR, 1.0f, "sound"}},
+    {0x2B, {1, false, OBJECT_KIND_BINARY_SENSOR, 1.0f, "tamper"}},
+    {0x2C, {1, false, OBJECT_KIND_BINARY_SENSOR, 1.0f, "vibration"}},
+    {0x2D, {1, false, OBJECT_KIND_BINARY_SENSOR, 1.0f, "window"}},
+
+    // Extended sensors
+    {0x3D, {2, false, OBJECT_KIND_SENSOR, 1.0f, "count_uint16"}},
+    {0x3E, {4, false, OBJECT_KIND_SENSOR, 1.0f, "count_uint32"}},
+    {0x3F, {2, true, OBJECT_KIND_SENSOR, 0.1f, "rotation"}},
+    {0x40, {2, false, OBJECT_KIND_SENSOR, 1.0f, "distance_mm"}},
+    {0x41, {2, false, OBJECT_KIND_SENSOR, 0.1f, "distance_m"}},
+    {0x42, {3, false, OBJECT_KIND_SENSOR, 0.001f, "duration"}},
+    {0x43, {2, false, OBJECT_KIND_SENSOR, 0.001f, "current"}},
+    {0x44, {2, false, OBJECT_KIND_SENSOR, 0.01f, "speed"}},
+    {0x45, {2, true, OBJECT_KIND_SENSOR, 0.1f, "temperature_01"}},
+    {0x46, {1, false, OBJECT_KIND_SENSOR, 0.1f, "uv_index"}},
+    {0x47, {2, false, OBJECT_KIND_SENSOR, 0.1f, "volume_l_01"}},
+    {0x48, {2, false, OBJECT_KIND_SENSOR, 1.0f, "volume_ml"}},
+    {0x49, {2, false, OBJECT_KIND_SENSOR, 0.001f, "volume_flow_rate"}},
+    {0x4A, {2, false, OBJECT_KIND_SENSOR, 0.1f, "voltage_01"}},
+    {0x4B, {3, false, OBJECT_KIND_SENSOR, 0.001f, "gas"}},
+    {0x4C, {4, false, OBJECT_KIND_SENSOR, 0.001f, "gas_uint32"}},
+    {0x4D, {4, false, OBJECT_KIND_SENSOR, 0.001f, "energy_uint32"}},
+    {0x4E, {4, false, OBJECT_KIND_SENSOR, 0.001f, "volume_l"}},
+    {0x4F, {4, false, OBJECT_KIND_SENSOR, 0.001f, "water"}},
+    {0x50, {4, false, OBJECT_KIND_SENSOR, 1.0f, "timestamp"}},
+    {0x51, {2, false, OBJECT_KIND_SENSOR, 0.001f, "acceleration"}},
+    {0x52, {2, false, OBJECT_KIND_SENSOR, 0.001f, "gyroscope"}},
+    {0x55, {4, false, OBJECT_KIND_SENSOR, 0.001f, "volume_storage"}},
+    {0x56, {2, false, OBJECT_KIND_SENSOR, 1.0f, "conductivity"}},
+    {0x57, {1, true, OBJECT_KIND_SENSOR, 1.0f, "temperature_sint8"}},
+    {0x58, {1, true, OBJECT_KIND_SENSOR, 0.35f, "temperature_sint8_035"}},
+    {0x59, {1, true, OBJECT_KIND_SENSOR, 1.0f, "count_sint8"}},
+    {0x5A, {2, true, OBJECT_KIND_SENSOR, 1.0f, "count_sint16"}},
+    {0x5B, {4, true, OBJECT_KIND_SENSOR, 1.0f, "count_sint32"}},
+    {0x5C, {4, true, OBJECT_KIND_SENSOR, 0.01f, "power_sint32"}},
+    {0x5D, {2, true, OBJECT_KIND_SENSOR, 0.001f, "current_sint16"}},
+    {0x5E, {2, false, OBJECT_KIND_SENSOR, 0.01f, "direction"}},
+    {0x5F, {2, false, OBJECT_KIND_SENSOR, 0.1f, "precipitation"}},
+    {0x60, {1, false, OBJECT_KIND_SENSOR, 1.0f, "channel"}},
+    {0x61, {2, false, OBJECT_KIND_SENSOR, 1.0f, "rotational_speed"}},
+
+    // Events and variable-length data
+    {0x3A, {1, false, OBJECT_KIND_EVENT, 1.0f, "button"}},
+    {0x3C, {1, true, OBJECT_KIND_EVENT, 1.0f, "dimmer"}},
+    {0x53, {0, false, OBJECT_KIND_VARIABLE, 1.0f, "text"}},
+    {0x54, {0, false, OBJECT_KIND_VARIABLE, 1.0f, "raw"}},
+};
+
+// Expand the definitions above into a table indexed directly by object ID.
+// Built at compile time so it lives in flash (.rodata) and needs no heap or static-init work;
+// object IDs without an entry stay zero-initialized (OBJECT_KIND_UNKNOWN).
+static constexpr std::array<ObjectTypeInfo, 256> build_object_type_table() {
+  std::array<ObjectTypeInfo, 256> table{};
+  for (const auto &entry : OBJECT_TYPE_ENTRIES) {
+    table[entry.object_id] = entry.info;
+  }
+  return table;
+}
+
+// The table is a function-local static of an inline function so every translation unit shares one copy
+inline const ObjectTypeInfo &get_object_type(uint8_t object_id) {
+  static constexpr std::array<ObjectTypeInfo, 256> OBJECT_TYPE_TABLE = build_object_type_table();
+  return OBJECT_TYPE_TABLE[object_id];
+}
+
+// =============================================================================
+// Decoding
+// =============================================================================
+
+// Read a 1-4 byte little-endian integer, sign-extending it when is_signed is set.
+// 64-bit so unsigned 32-bit objects (counts, timestamps) keep their full range.
+inline int64_t read_le(const uint8_t *data, uint8_t data_bytes, bool is_signed) {
+  uint32_t value = 0;
+  switch (data_bytes) {
+    case 4:
+      value |= static_cast<uint32_t>(data[3]) << 24;
+      [[fallthrough]];
+    case 3:
+      value |= static_cast<uint32_t>(data[2]) << 16;
+      [[fallthrough]];
+    case 2:
+      value |= static_cast<uint32_t>(data[1]) << 8;
+      [[fallthrough]];
+    case 1:
+      value |= data[0];
+      break;
+    default:
+      return 0;
+  }
+  if (!is_signed)
+    return value;
+  // Sign-extend from the top bit of the encoded width
+  uint32_t sign_bit = 1u << (data_bytes * 8 - 1);
+  return static_cast<int32_t>((value ^ sign_bit) - sign_bit);
+}
+
+enum DecodeStatus : uint8_t {
+  DECODE_OK = 0,
+  DECODE_END,             // No more objects
+  DECODE_TRUNCATED,       // Object ID known, but its payload runs past the end of the data
+  DECODE_UNKNOWN_OBJECT,  // Object ID not defined by BTHome v2 (size unknown)
+};
+
+// A single object located in a measurement payload. payload points into the caller's buffer;
+// for variable-length objects it points past the length byte.
+struct DecodedObject {
+  uint8_t object_id;
+  const ObjectTypeInfo *info;
+  const uint8_t *payload;
+  uint8_t payload_len;
+};
+
+// Locate the object at data[pos] and advance pos past it.
+// On DECODE_TRUNCATED and DECODE_UNKNOWN_OBJECT, object_id and info are still filled in and
+// pos points just past the object ID byte; the remaining data cannot be parsed.
+inline DecodeStatus next_object(const uint8_t *data, size_t len, size_t &pos, DecodedObject &obj) {
+  if (pos >= len)
+    return DECODE_END;
+
+  obj.object_id = data[pos++];
+  obj.info = &get_object_type(obj.object_id);
+
+  size_t payload_len = obj.info->data_bytes;
+  if (obj.info->kind == OBJECT_KIND_UNKNOWN)
+    return DECODE_UNKNOWN_OBJECT;
+  if (obj.info->kind == OBJECT_KIND_VARIABLE) {
+    if (pos >= len)
+      return DECODE_TRUNCATED;
+    payload_len = data[pos];
+    if (pos + 1 + payload_len > len)
+      return DECODE_TRUNCATED;
+    pos++;
+  } else if (pos + payload_len > len) {
+    return DECODE_TRUNCATED;
+  }
+
+  obj.payload = data + pos;
+  obj.payload_len = static_cast<uint8_t>(payload_len);
+  pos += payload_len;
+  return DECODE_OK;
+}
+
+// Find the BTHome service data in raw advertising data (a sequence of length/type/value AD
+// structures). Only the first four bytes of each structure are read, and the AD type and UUID are
+// compared as a single 24-bit value, so foreign advertisements are rejected cheaply.
+// On success service_data points past the UUID, into the caller's buffer.
+inline bool find_service_data(const uint8_t *data, size_t len, const uint8_t *&service_data,
+                              size_t &service_data_len) {
+  static const uint32_t HEADER = AD_TYPE_SERVICE_DATA_16 | (static_cast<uint32_t>(SERVICE_UUID) << 8);
+  size_t pos = 0;
+  while (pos + 4 <= len) {  // Length, AD type and 16-bit UUID
+    uint8_t ad_len = data[pos];
+    size_t next = pos + 1 + ad_len;
+    if (ad_len == 0 || next > len)
+      return false;
+    uint32_t header = data[pos + 1] | (data[pos + 2] << 8) | (static_cast<uint32_t>(data[pos + 3]) << 16);
+    if (header == HEADER && ad_len >= 3) {
+      service_data = data + pos + 4;
+      service_data_len = ad_len - 3;
+      return true;
+    }
+    pos = next;
+  }
+  return false;
+}
+
+// Raw integer value of a fixed-size object returned by next_object()
+inline int64_t decode_raw(const DecodedObject &obj) {
+  return read_le(obj.payload, obj.info->data_bytes, obj.info->is_signed);
+}
+
+// =============================================================================
+// Encoding
+// =============================================================================
+
+// Write the low data_bytes bytes of value in little-endian order
+inline void write_le(uint8_t *data, uint32_t value, uint8_t data_bytes) {
+  for (uint8_t i = 0; i < data_bytes; i++) {
+    data[i] = static_cast<uint8_t>(value >> (i * 8));
+  }
+}
+
+// Scale a value by 1/factor, rounding and clamping it to the range of a data_bytes integer
+inline uint32_t scale_value(float value, float factor, uint8_t data_bytes, bool is_signed) {
+  double scaled = std::round(value / factor);
+  if (is_signed) {
+    double max = static_cast<double>((int64_t(1) << (data_bytes * 8 - 1)) - 1);
+    double min = -max - 1.0;
+    scaled = scaled < min ? min : (scaled > max ? max : scaled);
+    return static_cast<uint32_t>(static_cast<int32_t>(scaled));
+  }
+  double max = static_cast<double>((int64_t(1) << (data_bytes * 8)) - 1);
+  scaled = scaled < 0.0 ? 0.0 : (scaled > max ? max : scaled);
+  return static_cast<uint32_t>(scaled);
+}
+
+// Encode a numeric object: object_id followed by a data_bytes little-endian integer.
+// Returns the number of bytes written, or 0 if it does not fit or data_bytes is not 1-4.
+inline size_t encode_value(uint8_t *data, size_t max_len, uint8_t object_id, float value, uint8_t data_bytes,
+                           bool is_signed, float factor) {
+  if (data_bytes < 1 || data_bytes > 4 || max_len < 1u + data_bytes)
+    return 0;
+  data[0] = object_id;
+  write_le(data + 1, scale_value(value, factor, data_bytes, is_signed), data_bytes);
+  return 1 + data_bytes;
+}
+
+// Encode a binary object: object_id followed by 0x00 or 0x01.
+// Returns the number of bytes written, or 0 if it does not fit.
+inline size_t encode_binary(uint8_t *data, size_t max_len, uint8_t object_id, bool value) {
+  if (max_len < 2)
+    return 0;
+  data[0] = object_id;
+  data[1] = value ? 0x01 : 0x00;
+  return 2;
+}
+
+}  // namespace bthome_codec
+}  // namespace esphome
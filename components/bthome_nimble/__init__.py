@@ -0,0 +1,47 @@
+"""
+Shared NimBLE host for the bthome and bthome_receiver components
+
+Owns the controller, the host task and the host sync/reset callbacks, so a node can
+broadcast its own BTHome sensors and receive other BTHome devices on one NimBLE stack.
+Loaded automatically by both components; only compiled in when one of them selects
+`ble_stack: nimble`.
+"""
+
+import esphome.codegen as cg
+from esphome.core import CORE
+
+CODEOWNERS = ["@esphome/core"]
+
+# GAP roles the shared host can be asked for
+ROLE_OBSERVER = "observer"
+ROLE_BROADCASTER = "broadcaster"
+
+_ROLES_KEY = "bthome_nimble_roles"
+
+
+def request_nimble_host(role):
+    """Enable the shared NimBLE host with the given GAP role.
+
+    Roles requested by several components are combined, so each call re-emits the
+    role options for everything requested so far.
+    """
+    # pylint: disable=import-outside-toplevel
+    from esphome.components.esp32 import add_idf_sdkconfig_option
+
+    roles = CORE.data.setdefault(_ROLES_KEY, set())
+    roles.add(role)
+
+    cg.add_define("USE_BTHOME_NIMBLE_HOST")
+    add_idf_sdkconfig_option("CONFIG_BT_ENABLED", True)
+    add_idf_sdkconfig_option("CONFIG_BT_NIMBLE_ENABLED", True)
+    add_idf_sdkconfig_option("CONFIG_BT_CONTROLLER_ENABLED", True)
+    add_idf_sdkconfig_option("CONFIG_BT_BLUEDROID_ENABLED", False)
+
+    # Only the roles in use: no connections, observer and/or broadcaster
+    add_idf_sdkconfig_option("CONFIG_BT_NIMBLE_ROLE_CENTRAL", False)
+    add_idf_sdkconfig_option("CONFIG_BT_NIMBLE_ROLE_PERIPHERAL", False)
+    add_idf_sdkconfig_option("CONFIG_BT_NIMBLE_ROLE_OBSERVER", ROLE_OBSERVER in roles)
+    add_idf_sdkconfig_option("CONFIG_BT_NIMBLE_ROLE_BROADCASTER", ROLE_BROADCASTER in roles)
+
+    # Use tinycrypt for smaller footprint (saves ~7KB)
+    add_idf_sdkconfig_option("CONFIG_BT_NIMBLE_CRYPTO_STACK_MBEDTLS", False)
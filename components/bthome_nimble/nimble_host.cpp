@@ -0,0 +1,85 @@
+#include "nimble_host.h"
+
+#ifdef USE_BTHOME_NIMBLE_HOST
+
+#include "esphome/core/log.h"
+
+#include "nimble/nimble_port.h"
+#include "nimble/nimble_port_freertos.h"
+#include "host/ble_hs.h"
+#include <nvs_flash.h>
+
+namespace esphome {
+namespace bthome_nimble {
+
+static const char *const TAG = "bthome_nimble";
+
+std::vector<NimBLEHostListener *> NimBLEHost::listeners_;
+bool NimBLEHost::started_ = false;
+bool NimBLEHost::start_failed_ = false;
+std::atomic<bool> NimBLEHost::synced_{false};
+std::atomic<bool> NimBLEHost::advertising_{false};
+
+bool NimBLEHost::start() {
+  if (started_ || start_failed_) {
+    return started_;
+  }
+
+  // Initialize NVS (required by NimBLE)
+  esp_err_t ret = nvs_flash_init();
+  if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+    ESP_ERROR_CHECK(nvs_flash_erase());
+    ret = nvs_flash_init();
+  }
+  if (ret != ESP_OK) {
+    ESP_LOGE(TAG, "NVS flash init failed: %s", esp_err_to_name(ret));
+    start_failed_ = true;
+    return false;
+  }
+
+  // For ESP-IDF 5.0+, nimble_port_init() handles BT controller init internally
+  ret = nimble_port_init();
+  if (ret != ESP_OK) {
+    ESP_LOGE(TAG, "nimble_port_init failed: %s", esp_err_to_name(ret));
+    start_failed_ = true;
+    return false;
+  }
+
+  // Configure NimBLE host callbacks, fanned out to every listener
+  ble_hs_cfg.sync_cb = on_sync_;
+  ble_hs_cfg.reset_cb = on_reset_;
+
+  // Start the one NimBLE host task
+  nimble_port_freertos_init(host_task_);
+  started_ = true;
+  ESP_LOGD(TAG, "NimBLE host started for %zu component(s), waiting for sync...", listeners_.size());
+  return true;
+}
+
+void NimBLEHost::host_task_(void *param) {
+  ESP_LOGD(TAG, "NimBLE host task started");
+  nimble_port_run();
+  nimble_port_freertos_deinit();
+}
+
+void NimBLEHost::on_sync_() {
+  ESP_LOGI(TAG, "NimBLE host-controller synchronized");
+  synced_.store(true, std::memory_order_release);
+  for (auto *listener : listeners_) {
+    listener->on_host_sync();
+  }
+}
+
+void NimBLEHost::on_reset_(int reason) {
+  ESP_LOGW(TAG, "NimBLE host reset, reason: %d", reason);
+  synced_.store(false, std::memory_order_release);
+  advertising_.store(false, std::memory_order_relaxed);
+  for (auto *listener : listeners_) {
+    listener->on_host_reset(reason);
+  }
+}
+
+}  // namespace bthome_nimble
+}  // namespace esphome
+
+#endif  // USE_BTHOME_NIMBLE_HOST
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "esphome/core/defines.h"
+
+#ifdef USE_BTHOME_NIMBLE_HOST
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace esphome {
+namespace bthome_nimble {
+
+// =============================================================================
+// NimBLEHostListener - Implemented by components sharing the NimBLE host.
+// Callbacks run on the NimBLE host task.
+// =============================================================================
+class NimBLEHostListener {
+ public:
+  // Host and controller are synced: (re)start scanning or advertising here
+  virtual void on_host_sync() {}
+  // Host reset: every GAP procedure has been stopped, wait for the next sync
+  virtual void on_host_reset(int reason) {}
+};
+
+// =============================================================================
+// NimBLEHost - One controller, one host task and one set of host callbacks for all users.
+// GAP event handlers stay per procedure: each component passes its own to ble_gap_disc() or
+// ble_gap_adv_start(), so the receiver's scan events never reach the broadcaster and vice versa.
+// =============================================================================
+class NimBLEHost {
+ public:
+  // Register a listener. Call from setup(), before any component calls start().
+  static void add_listener(NimBLEHostListener *listener) { listeners_.push_back(listener); }
+
+  // Initialize NVS, the controller and the host task on the first call; later calls only
+  // report the result of the first one. Never blocks for sync.
+  static bool start();
+
+  static bool is_started() { return started_; }
+  static bool is_synced() { return synced_.load(std::memory_order_acquire); }
+  static size_t get_listener_count() { return listeners_.size(); }
+
+  // Scan/advertising coordination. The broadcaster reports whether it is advertising, so the
+  // receiver can leave the controller room for advertising events between scan windows.
+  static void set_advertising(bool advertising) { advertising_.store(advertising, std::memory_order_relaxed); }
+  static bool is_advertising() { return advertising_.load(std::memory_order_relaxed); }
+
+ protected:
+  static void host_task_(void *param);
+  static void on_sync_();
+  static void on_reset_(int reason);
+
+  static std::vector<NimBLEHostListener *> listeners_;
+  static bool started_;
+  static bool start_failed_;
+  static std::atomic<bool> synced_;
+  static std::atomic<bool> advertising_;
+};
+
+}  // namespace bthome_nimble
+}  // namespace esphome
+
+#endif  // USE_BTHOME_NIMBLE_HOST
@@ -17,15 +17,23 @@ from esphome.const import (
     CONF_ID,
     CONF_MAC_ADDRESS,
     CONF_NAME,
+    CONF_TYPE,
+    ENTITY_CATEGORY_DIAGNOSTIC,
     PLATFORM_ESP32,
+    STATE_CLASS_MEASUREMENT,
+    STATE_CLASS_TOTAL_INCREASING,
+    UNIT_MICROSECOND,
+    UNIT_PERCENT,
 )
 from esphome import automation
 from esphome.core import CORE
 from esphome.components.esp32 import add_idf_sdkconfig_option
-from esphome.components import esp32_ble_tracker
+from esphome.components import esp32_ble_tracker, sensor
+from esphome.components.bthome_codec import BINARY_SENSOR_TYPES, SENSOR_TYPES
+from esphome.components.bthome_nimble import ROLE_OBSERVER, request_nimble_host
 
 CODEOWNERS = ["@esphome/core"]
-AUTO_LOAD = ["sensor", "binary_sensor", "text_sensor"]
+AUTO_LOAD = ["sensor", "binary_sensor", "text_sensor", "bthome_codec", "bthome_nimble"]
 
 # BLE stack options
 CONF_BLE_STACK = "ble_stack"
@@ -39,6 +47,30 @@ CONF_ON_DIMMER = "on_dimmer"
 CONF_EVENT = "event"
 CONF_BUTTON_INDEX = "button_index"
 CONF_DUMP_INTERVAL = "dump_interval"
+CONF_DISCOVERY_CACHE_SIZE = "discovery_cache_size"
+CONF_ADAPTIVE_SCAN = "adaptive_scan"
+CONF_CONTROLLER_FILTER = "controller_filter"
+
+# Receive pipeline metrics (counters, per-stage latency histograms, diagnostic sensors)
+CONF_METRICS = "metrics"
+CONF_LOG_INTERVAL = "log_interval"
+CONF_ADVERTISEMENT_RATE = "advertisement_rate"
+CONF_BTHOME_HIT_RATE = "bthome_hit_rate"
+CONF_QUEUE_DROPS = "queue_drops"
+
+# Auto-provisioning of unconfigured senders from a fixed device pool
+CONF_AUTO_PROVISION = "auto_provision"
+CONF_POOL_SIZE = "pool_size"
+CONF_MAC_PREFIXES = "mac_prefixes"
+CONF_ON_MEASUREMENT = "on_measurement"
+CONF_BINARY_TYPE = "binary_type"
+# Gateway profile: pool kept in a compact table (one allocation, optionally in PSRAM)
+CONF_STORAGE = "storage"
+CONF_KEY_SLOTS = "key_slots"
+CONF_PSRAM = "psram"
+STORAGE_OBJECTS = "objects"
+STORAGE_COMPACT = "compact"
+MAX_OBJECT_POOL_SIZE = 1024
 
 bthome_receiver_ns = cg.esphome_ns.namespace("bthome_receiver")
 # Note: BTHomeReceiverHub class definition depends on BLE stack at runtime
@@ -48,6 +80,19 @@ BTHomeDevice = bthome_receiver_ns.class_("BTHomeDevice", cg.Parented.template(BT
 BTHomeSensor = bthome_receiver_ns.class_("BTHomeSensor")
 BTHomeBinarySensor = bthome_receiver_ns.class_("BTHomeBinarySensor")
 BTHomeTextSensor = bthome_receiver_ns.class_("BTHomeTextSensor")
+PacketLayoutCache = bthome_receiver_ns.class_("PacketLayoutCache")
+PipelineStage = bthome_receiver_ns.enum("PipelineStage")
+
+# Mean latency sensor per pipeline stage
+STAGE_LATENCY_SENSORS = {
+    "callback_latency": PipelineStage.STAGE_CALLBACK,
+    "prefilter_latency": PipelineStage.STAGE_PREFILTER,
+    "queue_latency": PipelineStage.STAGE_QUEUE,
+    "lookup_latency": PipelineStage.STAGE_LOOKUP,
+    "decrypt_latency": PipelineStage.STAGE_DECRYPT,
+    "parse_latency": PipelineStage.STAGE_PARSE,
+    "publish_latency": PipelineStage.STAGE_PUBLISH,
+}
 
 # Event triggers
 BTHomeButtonTrigger = bthome_receiver_ns.class_(
@@ -58,105 +103,10 @@ int8_t = cg.global_ns.class_("int8_t")
 BTHomeDimmerTrigger = bthome_receiver_ns.class_(
     "BTHomeDimmerTrigger", automation.Trigger.template(int8_t)
 )
-
-# =============================================================================
-# BTHome v2 Sensor Object IDs - same as broadcaster component
-# Format: "type_name": (object_id, data_bytes, signed, factor)
-# =============================================================================
-SENSOR_TYPES = {
-    # Basic sensors
-    "packet_id": (0x00, 1, False, 1),
-    "battery": (0x01, 1, False, 1),
-    "temperature": (0x02, 2, True, 0.01),
-    "humidity": (0x03, 2, False, 0.01),
-    "pressure": (0x04, 3, False, 0.01),
-    "illuminance": (0x05, 3, False, 0.01),
-    "mass_kg": (0x06, 2, False, 0.01),
-    "mass_lb": (0x07, 2, False, 0.01),
-    "dewpoint": (0x08, 2, True, 0.01),
-    "count_uint8": (0x09, 1, False, 1),
-    "energy": (0x0A, 3, False, 0.001),
-    "power": (0x0B, 3, False, 0.01),
-    "voltage": (0x0C, 2, False, 0.001),
-    "pm2_5": (0x0D, 2, False, 1),
-    "pm10": (0x0E, 2, False, 1),
-    "co2": (0x12, 2, False, 1),
-    "tvoc": (0x13, 2, False, 1),
-    "moisture": (0x14, 2, False, 0.01),
-    "humidity_uint8": (0x2E, 1, False, 1),
-    "moisture_uint8": (0x2F, 1, False, 1),
-    # Extended sensors
-    "count_uint16": (0x3D, 2, False, 1),
-    "count_uint32": (0x3E, 4, False, 1),
-    "rotation": (0x3F, 2, True, 0.1),
-    "distance_mm": (0x40, 2, False, 1),
-    "distance_m": (0x41, 2, False, 0.1),
-    "duration": (0x42, 3, False, 0.001),
-    "current": (0x43, 2, False, 0.001),
-    "speed": (0x44, 2, False, 0.01),
-    "temperature_01": (0x45, 2, True, 0.1),
-    "uv_index": (0x46, 1, False, 0.1),
-    "volume_l_01": (0x47, 2, False, 0.1),
-    "volume_ml": (0x48, 2, False, 1),
-    "volume_flow_rate": (0x49, 2, False, 0.001),
-    "voltage_01": (0x4A, 2, False, 0.1),
-    "gas": (0x4B, 3, False, 0.001),
-    "gas_uint32": (0x4C, 4, False, 0.001),
-    "energy_uint32": (0x4D, 4, False, 0.001),
-    "volume_l": (0x4E, 4, False, 0.001),
-    "water": (0x4F, 4, False, 0.001),
-    "timestamp": (0x50, 4, False, 1),
-    "acceleration": (0x51, 2, False, 0.001),
-    "gyroscope": (0x52, 2, False, 0.001),
-    "volume_storage": (0x55, 4, False, 0.001),
-    "conductivity": (0x56, 2, False, 1),
-    "temperature_sint8": (0x57, 1, True, 1),
-    "temperature_sint8_035": (0x58, 1, True, 0.35),
-    "count_sint8": (0x59, 1, True, 1),
-    "count_sint16": (0x5A, 2, True, 1),
-    "count_sint32": (0x5B, 4, True, 1),
-    "power_sint32": (0x5C, 4, True, 0.01),
-    "current_sint16": (0x5D, 2, True, 0.001),
-    "direction": (0x5E, 2, False, 0.01),
-    "precipitation": (0x5F, 2, False, 0.1),
-    "channel": (0x60, 1, False, 1),
-    "rotational_speed": (0x61, 2, False, 1),
-}
-
-# =============================================================================
-# BTHome v2 Binary Sensor Object IDs
-# All are uint8: 0x00 = off/false, 0x01 = on/true
-# =============================================================================
-BINARY_SENSOR_TYPES = {
-    "generic_boolean": 0x0F,
-    "power": 0x10,
-    "opening": 0x11,
-    "battery_low": 0x15,
-    "battery_charging": 0x16,
-    "carbon_monoxide": 0x17,
-    "cold": 0x18,
-    "connectivity": 0x19,
-    "door": 0x1A,
-    "garage_door": 0x1B,
-    "gas": 0x1C,
-    "heat": 0x1D,
-    "light": 0x1E,
-    "lock": 0x1F,
-    "moisture_binary": 0x20,
-    "motion": 0x21,
-    "moving": 0x22,
-    "occupancy": 0x23,
-    "plug": 0x24,
-    "presence": 0x25,
-    "problem": 0x26,
-    "running": 0x27,
-    "safety": 0x28,
-    "smoke": 0x29,
-    "sound": 0x2A,
-    "tamper": 0x2B,
-    "vibration": 0x2C,
-    "window": 0x2D,
-}
+BTHomeMeasurementTrigger = bthome_receiver_ns.class_(
+    "BTHomeMeasurementTrigger",
+    automation.Trigger.template(cg.uint64, cg.uint8, cg.uint8, cg.float_),
+)
 
 # Button event types for automation triggers
 BUTTON_EVENT_TYPES = {
@@ -171,6 +121,24 @@ BUTTON_EVENT_TYPES = {
 }
 
 
+def entity_storage(device_id, entity_class, count, suffix):
+    """Declare a static array of count entity slots for one device.
+
+    The device fills it in place (set_*_storage() + add_*()), so registering entities
+    never touches the heap. Returns the expression naming the array.
+    """
+    name = f"{device_id.id}_{suffix}"
+    cg.add_global(cg.RawStatement(f"static {entity_class} {name}[{count}];"))
+    return cg.RawExpression(name)
+
+
+def layout_cache(device_id):
+    """Declare the static packet layout cache of one device. Returns its address."""
+    name = f"{device_id.id}_layout"
+    cg.add_global(cg.RawStatement(f"static {PacketLayoutCache} {name};"))
+    return cg.RawExpression(f"&{name}")
+
+
 def validate_encryption_key(value):
     """Validate 16-byte (32 hex char) AES encryption key."""
     value = cv.string_strict(value)
@@ -198,6 +166,62 @@ DIMMER_TRIGGER_SCHEMA = automation.validate_automation(
     }
 )
 
+def validate_mac_prefix(value):
+    """Validate a MAC prefix of 1-6 octets, e.g. "A4:C1:38". Returns (prefix, mask) as 48-bit ints."""
+    value = cv.string_strict(value)
+    octets = value.replace("-", ":").split(":")
+    if not 1 <= len(octets) <= 6 or any(len(o) != 2 for o in octets):
+        raise cv.Invalid("MAC prefix must be 1 to 6 octets in format XX:XX:XX")
+    try:
+        prefix = int("".join(octets), 16)
+    except ValueError as e:
+        raise cv.Invalid("MAC prefix must be valid hexadecimal") from e
+    shift = 8 * (6 - len(octets))
+    return (prefix << shift, ((1 << (8 * len(octets))) - 1) << shift)
+
+
+MEASUREMENT_TRIGGER_SCHEMA = automation.validate_automation(
+    {
+        cv.GenerateID(): cv.declare_id(BTHomeMeasurementTrigger),
+        # Restrict to one sensor or binary sensor type (default: every object)
+        cv.Optional(CONF_TYPE): cv.one_of(*[t for t in SENSOR_TYPES if t != "packet_id"], lower=True),
+        cv.Optional(CONF_BINARY_TYPE): cv.one_of(*BINARY_SENSOR_TYPES, lower=True),
+    },
+    extra_validators=cv.has_at_most_one_key(CONF_TYPE, CONF_BINARY_TYPE),
+)
+
+def validate_auto_provision(config):
+    """Options of the compact table are rejected for the object pool, which is also smaller."""
+    if config[CONF_STORAGE] == STORAGE_OBJECTS:
+        if config[CONF_POOL_SIZE] > MAX_OBJECT_POOL_SIZE:
+            raise cv.Invalid(
+                f"{CONF_POOL_SIZE} above {MAX_OBJECT_POOL_SIZE} requires {CONF_STORAGE}: {STORAGE_COMPACT}"
+            )
+        for key in (CONF_KEY_SLOTS, CONF_PSRAM):
+            if key in config:
+                raise cv.Invalid(f"{key} requires {CONF_STORAGE}: {STORAGE_COMPACT}")
+    return config
+
+
+AUTO_PROVISION_SCHEMA = cv.All(
+    cv.Schema(
+        {
+            cv.Optional(CONF_POOL_SIZE, default=16): cv.int_range(min=1, max=4096),
+            cv.Optional(CONF_MAC_PREFIXES, default=[]): cv.ensure_list(validate_mac_prefix),
+            cv.Optional(CONF_ON_MEASUREMENT): MEASUREMENT_TRIGGER_SCHEMA,
+            # objects: one BTHomeDevice per sender; compact: parallel arrays in one block
+            cv.Optional(CONF_STORAGE, default=STORAGE_OBJECTS): cv.one_of(
+                STORAGE_OBJECTS, STORAGE_COMPACT, lower=True
+            ),
+            # Encryption keys the compact table can hold, assigned with provision_sender(mac, key)
+            cv.Optional(CONF_KEY_SLOTS): cv.int_range(min=0, max=4096),
+            # Place the compact table in PSRAM when the board has it
+            cv.Optional(CONF_PSRAM): cv.boolean,
+        }
+    ),
+    validate_auto_provision,
+)
+
 DEVICE_SCHEMA = cv.Schema(
     {
         cv.GenerateID(): cv.declare_id(BTHomeDevice),
@@ -209,9 +233,34 @@ DEVICE_SCHEMA = cv.Schema(
     }
 )
 
-# Import esp32_ble_tracker at module level for schema extension
-# pylint: disable=wrong-import-position
-from esphome.components import esp32_ble_tracker
+_METRICS_SCHEMA_DICT = {
+    cv.Optional(CONF_LOG_INTERVAL, default="60s"): cv.positive_not_null_time_period,
+    cv.Optional(CONF_ADVERTISEMENT_RATE): sensor.sensor_schema(
+        unit_of_measurement="adv/s",
+        accuracy_decimals=1,
+        state_class=STATE_CLASS_MEASUREMENT,
+        entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+    ),
+    cv.Optional(CONF_BTHOME_HIT_RATE): sensor.sensor_schema(
+        unit_of_measurement=UNIT_PERCENT,
+        accuracy_decimals=1,
+        state_class=STATE_CLASS_MEASUREMENT,
+        entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+    ),
+    cv.Optional(CONF_QUEUE_DROPS): sensor.sensor_schema(
+        accuracy_decimals=0,
+        state_class=STATE_CLASS_TOTAL_INCREASING,
+        entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+    ),
+}
+for _stage_sensor in STAGE_LATENCY_SENSORS:
+    _METRICS_SCHEMA_DICT[cv.Optional(_stage_sensor)] = sensor.sensor_schema(
+        unit_of_measurement=UNIT_MICROSECOND,
+        accuracy_decimals=0,
+        state_class=STATE_CLASS_MEASUREMENT,
+        entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+    )
+METRICS_SCHEMA = cv.Schema(_METRICS_SCHEMA_DICT)
 
 # Base schema that applies to all modes
 # _BASE_SCHEMA = cv.Schema(
@@ -239,6 +288,10 @@ def _final_validate(config):
     if ble_stack == BLE_STACK_NIMBLE:
         if CORE.using_arduino:
             raise cv.Invalid("NimBLE BLE stack requires ESP-IDF framework, not Arduino")
+    elif config.get(CONF_ADAPTIVE_SCAN):
+        raise cv.Invalid("adaptive_scan is only supported with the NimBLE BLE stack")
+    elif config.get(CONF_CONTROLLER_FILTER):
+        raise cv.Invalid("controller_filter is only supported with the NimBLE BLE stack")
     return config
 
 
@@ -259,6 +312,16 @@ CONFIG_SCHEMA = cv.All(
             ),
             # Interval for periodic dump of all detected devices (0 = disabled)
             cv.Optional(CONF_DUMP_INTERVAL): cv.positive_time_period_milliseconds,
+            # Number of devices remembered for the periodic dump (least recently seen evicted first)
+            cv.Optional(CONF_DISCOVERY_CACHE_SIZE, default=32): cv.int_range(min=1, max=1024),
+            # NimBLE only: adapt the scan window to when registered devices are expected
+            cv.Optional(CONF_ADAPTIVE_SCAN, default=False): cv.boolean,
+            # NimBLE only: controller duplicate filter + accept list of registered devices
+            cv.Optional(CONF_CONTROLLER_FILTER, default=False): cv.boolean,
+            # Receive pipeline counters and latency histograms, summarized every log_interval
+            cv.Optional(CONF_METRICS): METRICS_SCHEMA,
+            # Claim devices for unconfigured senders from a fixed pool
+            cv.Optional(CONF_AUTO_PROVISION): AUTO_PROVISION_SCHEMA,
         }
     )
     .extend(esp32_ble_tracker.ESP_BLE_DEVICE_SCHEMA)
@@ -274,27 +337,70 @@ async def to_code(config):
     # Set dump interval for periodic summary (0 = disabled)
     if CONF_DUMP_INTERVAL in config:
         cg.add(var.set_dump_interval(config[CONF_DUMP_INTERVAL]))
+    cg.add(var.set_discovery_cache_size(config[CONF_DISCOVERY_CACHE_SIZE]))
+
+    if CONF_AUTO_PROVISION in config:
+        provision_conf = config[CONF_AUTO_PROVISION]
+        cg.add(var.set_auto_provision_pool_size(provision_conf[CONF_POOL_SIZE]))
+        if provision_conf[CONF_STORAGE] == STORAGE_COMPACT:
+            cg.add(
+                var.set_auto_provision_compact(
+                    provision_conf.get(CONF_KEY_SLOTS, 0), provision_conf.get(CONF_PSRAM, False)
+                )
+            )
+        for prefix, mask in provision_conf[CONF_MAC_PREFIXES]:
+            cg.add(var.add_auto_provision_prefix(prefix, mask))
+        for conf in provision_conf.get(CONF_ON_MEASUREMENT, []):
+            trigger = cg.new_Pvariable(conf[CONF_ID])
+            if CONF_TYPE in conf:
+                cg.add(trigger.set_object_id(SENSOR_TYPES[conf[CONF_TYPE]][0]))
+            elif CONF_BINARY_TYPE in conf:
+                cg.add(trigger.set_object_id(BINARY_SENSOR_TYPES[conf[CONF_BINARY_TYPE]]))
+            cg.add(var.add_measurement_trigger(trigger))
+            await automation.build_automation(
+                trigger,
+                [(cg.uint64, "mac"), (cg.uint8, "object_id"), (cg.uint8, "index"), (cg.float_, "value")],
+                conf,
+            )
+
+    if CONF_METRICS in config:
+        metrics_conf = config[CONF_METRICS]
+        cg.add_define("USE_BTHOME_RECEIVER_METRICS")
+        cg.add(var.set_metrics_interval(metrics_conf[CONF_LOG_INTERVAL].total_milliseconds))
+        if CONF_ADVERTISEMENT_RATE in metrics_conf:
+            sens = await sensor.new_sensor(metrics_conf[CONF_ADVERTISEMENT_RATE])
+            cg.add(var.set_advertisement_rate_sensor(sens))
+        if CONF_BTHOME_HIT_RATE in metrics_conf:
+            sens = await sensor.new_sensor(metrics_conf[CONF_BTHOME_HIT_RATE])
+            cg.add(var.set_hit_rate_sensor(sens))
+        if CONF_QUEUE_DROPS in metrics_conf:
+            sens = await sensor.new_sensor(metrics_conf[CONF_QUEUE_DROPS])
+            cg.add(var.set_queue_drops_sensor(sens))
+        for key, stage in STAGE_LATENCY_SENSORS.items():
+            if key in metrics_conf:
+                sens = await sensor.new_sensor(metrics_conf[key])
+                cg.add(var.set_stage_latency_sensor(stage, sens))
 
     ble_stack = config.get(CONF_BLE_STACK, BLE_STACK_BLUEDROID)
 
     if ble_stack == BLE_STACK_NIMBLE:
         # NimBLE stack configuration
         cg.add_define("USE_BTHOME_RECEIVER_NIMBLE")
-
-        # Enable NimBLE in ESP-IDF
-        add_idf_sdkconfig_option("CONFIG_BT_ENABLED", True)
-        add_idf_sdkconfig_option("CONFIG_BT_NIMBLE_ENABLED", True)
-        add_idf_sdkconfig_option("CONFIG_BT_CONTROLLER_ENABLED", True)
-        add_idf_sdkconfig_option("CONFIG_BT_BLUEDROID_ENABLED", False)
-
-        # Configure NimBLE roles - only observer needed for receiving
-        add_idf_sdkconfig_option("CONFIG_BT_NIMBLE_ROLE_OBSERVER", True)
-        add_idf_sdkconfig_option("CONFIG_BT_NIMBLE_ROLE_BROADCASTER", False)
-        add_idf_sdkconfig_option("CONFIG_BT_NIMBLE_ROLE_CENTRAL", False)
-        add_idf_sdkconfig_option("CONFIG_BT_NIMBLE_ROLE_PERIPHERAL", False)
-
-        # Use tinycrypt for smaller footprint
-        add_idf_sdkconfig_option("CONFIG_BT_NIMBLE_CRYPTO_STACK_MBEDTLS", False)
+        cg.add(var.set_adaptive_scan(config[CONF_ADAPTIVE_SCAN]))
+        cg.add(var.set_controller_filter(config[CONF_CONTROLLER_FILTER]))
+        if config[CONF_CONTROLLER_FILTER]:
+            # Key the controller's duplicate filter on address + advertisement data, so new
+            # readings pass and only retransmissions are dropped. The cache is refreshed
+            # periodically so unchanged payloads without a packet ID still get through.
+            # (BTDM_* applies to the original ESP32, BT_CTRL_* to newer chips.)
+            add_idf_sdkconfig_option("CONFIG_BTDM_SCAN_DUPL_TYPE_DATA_DEVICE", True)
+            add_idf_sdkconfig_option("CONFIG_BTDM_SCAN_DUPL_CACHE_REFRESH_PERIOD", 60)
+            add_idf_sdkconfig_option("CONFIG_BT_CTRL_SCAN_DUPL_TYPE_DATA_DEVICE", True)
+            add_idf_sdkconfig_option("CONFIG_BT_CTRL_SCAN_DUPL_CACHE_REFRESH_PERIOD", 60)
+
+        # Enable NimBLE in ESP-IDF with the observer role. The host is shared with the bthome
+        # broadcaster, which adds the broadcaster role if present.
+        request_nimble_host(ROLE_OBSERVER)
 
         # Disable privacy/security features we don't need (avoids SM requirement)
         add_idf_sdkconfig_option("CONFIG_BT_NIMBLE_SECURITY_ENABLE", False)
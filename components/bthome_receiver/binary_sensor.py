@@ -20,6 +20,8 @@ from . import (
     BTHomeReceiverHub,
     CONF_ENCRYPTION_KEY,
     bthome_receiver_ns,
+    entity_storage,
+    layout_cache,
     validate_encryption_key,
 )
 
@@ -99,16 +101,27 @@ async def to_code(config):
         key_array = cg.RawExpression(f"std::array<uint8_t, 16>{{{{{', '.join(str(b) for b in key_bytes)}}}}}")
         cg.add(device_var.set_encryption_key(key_array))
 
+    # Static table sized to the configured types, registered in object ID order
+    entries = sorted(
+        (object_id, sensor_type)
+        for sensor_type, object_id in BINARY_SENSOR_TYPES.items()
+        if sensor_type in config
+    )
+    if entries:
+        storage = entity_storage(config[CONF_ID], BTHomeBinarySensor, len(entries), "binary_sensors")
+        cg.add(device_var.set_binary_sensor_storage(storage, len(entries)))
+
     # Create binary sensors for each configured type
-    for sensor_type, object_id in BINARY_SENSOR_TYPES.items():
-        if sensor_type in config:
-            sensor_config = config[sensor_type]
+    for object_id, sensor_type in entries:
+        # Create the ESPHome binary sensor
+        sens = await binary_sensor.new_binary_sensor(config[sensor_type])
 
-            # Create the ESPHome binary sensor
-            sens = await binary_sensor.new_binary_sensor(sensor_config)
+        # Register binary sensor with device (object_id, binary_sensor*)
+        cg.add(device_var.add_binary_sensor(object_id, sens))
 
-            # Register binary sensor with device (object_id, binary_sensor*)
-            cg.add(device_var.add_binary_sensor(object_id, sens))
+    # Repeat-format packets skip the generic parser once their layout is learned
+    if entries:
+        cg.add(device_var.set_layout_cache(layout_cache(config[CONF_ID])))
 
     # Register device with hub
     cg.add(hub.register_device(device_var))
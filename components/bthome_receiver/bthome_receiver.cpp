@@ -1,7 +1,7 @@
 #include "bthome_receiver.h"
 #include "esphome/core/log.h"
-#include "mbedtls/ccm.h"
 
+#include <algorithm>
 #include <cstring>
 #include <cmath>
 
@@ -19,206 +19,48 @@ static const char *const TAG = "bthome_receiver";
 BTHomeReceiverHub *BTHomeReceiverHub::instance_ = nullptr;
 #endif
 
-// BTHome v2 object type lookup table
-// Format: object_id -> (data_bytes, is_signed, factor, is_sensor, is_binary_sensor)
-static const std::map<uint8_t, ObjectTypeInfo> OBJECT_TYPE_MAP = {
-    // Basic sensors
-    {0x00, {1, false, 1, true, false}},           // packet_id
-    {0x01, {1, false, 1, true, false}},           // battery
-    {0x02, {2, true, 0.01, true, false}},         // temperature
-    {0x03, {2, false, 0.01, true, false}},        // humidity
-    {0x04, {3, false, 0.01, true, false}},        // pressure
-    {0x05, {3, false, 0.01, true, false}},        // illuminance
-    {0x06, {2, false, 0.01, true, false}},        // mass_kg
-    {0x07, {2, false, 0.01, true, false}},        // mass_lb
-    {0x08, {2, true, 0.01, true, false}},         // dewpoint
-    {0x09, {1, false, 1, true, false}},           // count_uint8
-    {0x0A, {3, false, 0.001, true, false}},       // energy
-    {0x0B, {3, false, 0.01, true, false}},        // power
-    {0x0C, {2, false, 0.001, true, false}},       // voltage
-    {0x0D, {2, false, 1, true, false}},           // pm2_5
-    {0x0E, {2, false, 1, true, false}},           // pm10
-    {0x12, {2, false, 1, true, false}},           // co2
-    {0x13, {2, false, 1, true, false}},           // tvoc
-    {0x14, {2, false, 0.01, true, false}},        // moisture
-    {0x2E, {1, false, 1, true, false}},           // humidity_uint8
-    {0x2F, {1, false, 1, true, false}},           // moisture_uint8
-
-    // Binary sensors
-    {0x0F, {1, false, 1, false, true}},           // generic_boolean
-    {0x10, {1, false, 1, false, true}},           // power
-    {0x11, {1, false, 1, false, true}},           // opening
-    {0x15, {1, false, 1, false, true}},           // battery_low
-    {0x16, {1, false, 1, false, true}},           // battery_charging
-    {0x17, {1, false, 1, false, true}},           // carbon_monoxide
-    {0x18, {1, false, 1, false, true}},           // cold
-    {0x19, {1, false, 1, false, true}},           // connectivity
-    {0x1A, {1, false, 1, false, true}},           // door
-    {0x1B, {1, false, 1, false, true}},           // garage_door
-    {0x1C, {1, false, 1, false, true}},           // gas
-    {0x1D, {1, false, 1, false, true}},           // heat
-    {0x1E, {1, false, 1, false, true}},           // light
-    {0x1F, {1, false, 1, false, true}},           // lock
-    {0x20, {1, false, 1, false, true}},           // moisture_binary
-    {0x21, {1, false, 1, false, true}},           // motion
-    {0x22, {1, false, 1, false, true}},           // moving
-    {0x23, {1, false, 1, false, true}},           // occupancy
-    {0x24, {1, false, 1, false, true}},           // plug
-    {0x25, {1, false, 1, false, true}},           // presence
-    {0x26, {1, false, 1, false, true}},           // problem
-    {0x27, {1, false, 1, false, true}},           // running
-    {0x28, {1, false, 1, false, true}},           // safety
-    {0x29, {1, false, 1, false, true}},           // smoke
-    {0x2A, {1, false, 1, false, true}},           // sound
-    {0x2B, {1, false, 1, false, true}},           // tamper
-    {0x2C, {1, false, 1, false, true}},           // vibration
-    {0x2D, {1, false, 1, false, true}},           // window
-
-    // Extended sensors
-    {0x3D, {2, false, 1, true, false}},           // count_uint16
-    {0x3E, {4, false, 1, true, false}},           // count_uint32
-    {0x3F, {2, true, 0.1, true, false}},          // rotation
-    {0x40, {2, false, 1, true, false}},           // distance_mm
-    {0x41, {2, false, 0.1, true, false}},         // distance_m
-    {0x42, {3, false, 0.001, true, false}},       // duration
-    {0x43, {2, false, 0.001, true, false}},       // current
-    {0x44, {2, false, 0.01, true, false}},        // speed
-    {0x45, {2, true, 0.1, true, false}},          // temperature_01
-    {0x46, {1, false, 0.1, true, false}},         // uv_index
-    {0x47, {2, false, 0.1, true, false}},         // volume_l_01
-    {0x48, {2, false, 1, true, false}},           // volume_ml
-    {0x49, {2, false, 0.001, true, false}},       // volume_flow_rate
-    {0x4A, {2, false, 0.1, true, false}},         // voltage_01
-    {0x4B, {3, false, 0.001, true, false}},       // gas
-    {0x4C, {4, false, 0.001, true, false}},       // gas_uint32
-    {0x4D, {4, false, 0.001, true, false}},       // energy_uint32
-    {0x4E, {4, false, 0.001, true, false}},       // volume_l
-    {0x4F, {4, false, 0.001, true, false}},       // water
-    {0x50, {4, false, 1, true, false}},           // timestamp
-    {0x51, {2, false, 0.001, true, false}},       // acceleration
-    {0x52, {2, false, 0.001, true, false}},       // gyroscope
-    {0x55, {4, false, 0.001, true, false}},       // volume_storage
-    {0x56, {2, false, 1, true, false}},           // conductivity
-    {0x57, {1, true, 1, true, false}},            // temperature_sint8
-    {0x58, {1, true, 0.35, true, false}},         // temperature_sint8_035
-    {0x59, {1, true, 1, true, false}},            // count_sint8
-    {0x5A, {2, true, 1, true, false}},            // count_sint16
-    {0x5B, {4, true, 1, true, false}},            // count_sint32
-    {0x5C, {4, true, 0.01, true, false}},         // power_sint32
-    {0x5D, {2, true, 0.001, true, false}},        // current_sint16
-    {0x5E, {2, false, 0.01, true, false}},        // direction
-    {0x5F, {2, false, 0.1, true, false}},         // precipitation
-    {0x60, {1, false, 1, true, false}},           // channel
-    {0x61, {2, false, 1, true, false}},           // rotational_speed
-};
-
-// Object ID to human-readable name mapping (for dump mode)
-static const std::map<uint8_t, const char *> OBJECT_ID_NAMES = {
-    // Sensors
-    {0x00, "packet_id"},
-    {0x01, "battery"},
-    {0x02, "temperature"},
-    {0x03, "humidity"},
-    {0x04, "pressure"},
-    {0x05, "illuminance"},
-    {0x06, "mass_kg"},
-    {0x07, "mass_lb"},
-    {0x08, "dewpoint"},
-    {0x09, "count"},
-    {0x0A, "energy"},
-    {0x0B, "power"},
-    {0x0C, "voltage"},
-    {0x0D, "pm2_5"},
-    {0x0E, "pm10"},
-    {0x12, "co2"},
-    {0x13, "tvoc"},
-    {0x14, "moisture"},
-    {0x2E, "humidity_uint8"},
-    {0x2F, "moisture_uint8"},
-    // Binary sensors
-    {0x0F, "generic_boolean"},
-    {0x10, "power_binary"},
-    {0x11, "opening"},
-    {0x15, "battery_low"},
-    {0x16, "battery_charging"},
-    {0x17, "carbon_monoxide"},
-    {0x18, "cold"},
-    {0x19, "connectivity"},
-    {0x1A, "door"},
-    {0x1B, "garage_door"},
-    {0x1C, "gas"},
-    {0x1D, "heat"},
-    {0x1E, "light"},
-    {0x1F, "lock"},
-    {0x20, "moisture_binary"},
-    {0x21, "motion"},
-    {0x22, "moving"},
-    {0x23, "occupancy"},
-    {0x24, "plug"},
-    {0x25, "presence"},
-    {0x26, "problem"},
-    {0x27, "running"},
-    {0x28, "safety"},
-    {0x29, "smoke"},
-    {0x2A, "sound"},
-    {0x2B, "tamper"},
-    {0x2C, "vibration"},
-    {0x2D, "window"},
-    // Events
-    {0x3A, "button"},
-    {0x3C, "dimmer"},
-    // Extended sensors
-    {0x3D, "count_uint16"},
-    {0x3E, "count_uint32"},
-    {0x3F, "rotation"},
-    {0x40, "distance_mm"},
-    {0x41, "distance_m"},
-    {0x42, "duration"},
-    {0x43, "current"},
-    {0x44, "speed"},
-    {0x45, "temperature_01"},
-    {0x46, "uv_index"},
-    {0x47, "volume_l_01"},
-    {0x48, "volume_ml"},
-    {0x49, "volume_flow_rate"},
-    {0x4A, "voltage_01"},
-    {0x4B, "gas"},
-    {0x4C, "gas_uint32"},
-    {0x4D, "energy_uint32"},
-    {0x4E, "volume_l"},
-    {0x4F, "water"},
-    {0x50, "timestamp"},
-    {0x51, "acceleration"},
-    {0x52, "gyroscope"},
-    {0x53, "text"},
-    {0x54, "raw"},
-    {0x55, "volume_storage"},
-    {0x56, "conductivity"},
-    {0x57, "temperature_sint8"},
-    {0x58, "temperature_sint8_035"},
-    {0x59, "count_sint8"},
-    {0x5A, "count_sint16"},
-    {0x5B, "count_sint32"},
-    {0x5C, "power_sint32"},
-    {0x5D, "current_sint16"},
-    {0x5E, "direction"},
-    {0x5F, "precipitation"},
-    {0x60, "channel"},
-    {0x61, "rotational_speed"},
-};
-
 // ============================================================================
 // BTHomeReceiverHub Implementation
 // ============================================================================
 
+// Hash a 48-bit MAC address into a 32-bit value for the device index.
+// Fold the upper bits down, then multiply by the golden-ratio constant to spread sequential MACs.
+static inline uint32_t hash_mac(uint64_t address) {
+  uint32_t h = static_cast<uint32_t>(address) ^ static_cast<uint32_t>(address >> 24);
+  h *= 0x9E3779B1u;
+  return h ^ (h >> 16);
+}
+
+// Add to a 16-bit compact table counter, sticking at the maximum instead of wrapping
+static inline void add_saturating(uint16_t &counter, uint32_t amount) {
+  counter = std::min<uint32_t>(counter + amount, UINT16_MAX);
+}
+
 void BTHomeReceiverHub::setup() {
   ESP_LOGCONFIG(TAG, "Setting up BTHome Receiver...");
 
+  if (this->pool_capacity_ > 0 && this->compact_pool_) {
+    // Gateway profile: one block for every sender's state, the MAC index and the key slots
+    if (!this->compact_table_.allocate(this->pool_capacity_, this->compact_key_slots_, this->compact_psram_)) {
+      ESP_LOGE(TAG, "Could not allocate the compact device table for %u devices, auto-provisioning disabled",
+               this->pool_capacity_);
+      this->pool_capacity_ = 0;
+    }
+  } else if (this->pool_capacity_ > 0) {
+    // One allocation each for the pool and the registry, claimed devices are constructed in place
+    this->pool_.reserve(this->pool_capacity_);
+    this->devices_.reserve(this->devices_.size() + this->pool_capacity_);
+  }
+  this->build_device_index_();
+  if (this->dump_interval_ > 0) {
+    this->allocate_discovery_cache_();
+  }
+
 #ifdef USE_BTHOME_RECEIVER_NIMBLE
   instance_ = this;
-  // Defer actual BLE initialization to loop() to ensure all other components are ready
-  this->nimble_initialized_ = false;
-  this->init_attempted_ = false;
+  // Listeners must be registered before anyone starts the shared host
+  bthome_nimble::NimBLEHost::add_listener(this);
+  // NimBLE is started from the first loop(), once every other component is set up
   ESP_LOGI(TAG, "BTHome Receiver configured, BLE init deferred to loop");
 #else
   // Bluedroid setup is handled by esp32_ble_tracker
@@ -227,56 +69,18 @@ void BTHomeReceiverHub::setup() {
 }
 
 #ifdef USE_BTHOME_RECEIVER_NIMBLE
-// Static semaphore for waiting on NimBLE sync
-static SemaphoreHandle_t nimble_sync_semaphore_ = nullptr;
-
 void BTHomeReceiverHub::init_nimble_() {
+  // The host may already be running for the bthome broadcaster; start() only initializes it once
   ESP_LOGI(TAG, "Initializing NimBLE...");
-
-  // Create semaphore to wait for host-controller sync
-  nimble_sync_semaphore_ = xSemaphoreCreateBinary();
-  if (nimble_sync_semaphore_ == nullptr) {
-    ESP_LOGE(TAG, "Failed to create sync semaphore");
-    this->mark_failed();
-    return;
-  }
-
-  // For ESP-IDF 5.0+, nimble_port_init() handles BT controller init internally
-  // Just call it directly - no manual esp_bt_controller_init/enable needed
-  esp_err_t ret = nimble_port_init();
-  if (ret != ESP_OK) {
-    ESP_LOGE(TAG, "nimble_port_init failed: %s", esp_err_to_name(ret));
-    vSemaphoreDelete(nimble_sync_semaphore_);
-    nimble_sync_semaphore_ = nullptr;
+  if (!bthome_nimble::NimBLEHost::start()) {
+    this->nimble_state_ = NIMBLE_FAILED;
     this->mark_failed();
     return;
   }
 
-  ESP_LOGI(TAG, "NimBLE port initialized, configuring host");
-
-  // Configure NimBLE host callbacks
-  ble_hs_cfg.reset_cb = nimble_on_reset_;
-  ble_hs_cfg.sync_cb = nimble_on_sync_;
-
-  // Start NimBLE host task
-  nimble_port_freertos_init(nimble_host_task_);
-
-  // Wait for host-controller sync (with timeout)
-  ESP_LOGI(TAG, "Waiting for NimBLE host sync...");
-  if (xSemaphoreTake(nimble_sync_semaphore_, pdMS_TO_TICKS(5000)) != pdTRUE) {
-    ESP_LOGE(TAG, "Timeout waiting for NimBLE sync");
-    vSemaphoreDelete(nimble_sync_semaphore_);
-    nimble_sync_semaphore_ = nullptr;
-    this->mark_failed();
-    return;
-  }
-
-  // Cleanup semaphore
-  vSemaphoreDelete(nimble_sync_semaphore_);
-  nimble_sync_semaphore_ = nullptr;
-
-  this->nimble_initialized_ = true;
-  ESP_LOGI(TAG, "NimBLE receiver initialized successfully");
+  // Sync is picked up by loop(), which never waits for it
+  this->nimble_init_time_ = esp_timer_get_time() / 1000;
+  this->nimble_state_ = NIMBLE_WAIT_SYNC;
 }
 #endif
 
@@ -284,195 +88,648 @@ void BTHomeReceiverHub::dump_config() {
   ESP_LOGCONFIG(TAG, "BTHome Receiver:");
 #ifdef USE_BTHOME_RECEIVER_NIMBLE
   ESP_LOGCONFIG(TAG, "  BLE Stack: NimBLE");
+  ESP_LOGCONFIG(TAG, "  Advertisement Queue: %u slots, high-water %u, dropped %u", (unsigned) ADV_QUEUE_SIZE,
+                this->get_queue_high_water(), this->get_queue_drops());
+  if (this->controller_filter_) {
+    ESP_LOGCONFIG(TAG, "  Controller Filter: duplicates%s",
+                  this->dump_interval_ == 0 && this->pool_capacity_ == 0 ? " + accept list" : "");
+  }
+  if (this->adaptive_scan_) {
+    ESP_LOGCONFIG(TAG, "  Adaptive Scan: duty %u%%, %u changes, time low/normal/high %u/%u/%ums",
+                  this->get_scan_duty_percent(), this->scan_duty_changes_, this->scan_duty_time_[SCAN_DUTY_LOW],
+                  this->scan_duty_time_[SCAN_DUTY_NORMAL], this->scan_duty_time_[SCAN_DUTY_HIGH]);
+  } else {
+    ESP_LOGCONFIG(TAG, "  Scan Duty: %u%% (fixed)", this->get_scan_duty_percent());
+  }
 #else
   ESP_LOGCONFIG(TAG, "  BLE Stack: Bluedroid");
+#endif
+#ifdef USE_BTHOME_RECEIVER_NIMBLE
+  ESP_LOGCONFIG(TAG, "  Startup: first scan %ums, first values %ums after boot (0 = not yet)",
+                this->get_boot_to_first_scan_ms(), this->first_publish_ms_);
+#else
+  ESP_LOGCONFIG(TAG, "  Startup: first values %ums after boot (0 = not yet)", this->first_publish_ms_);
 #endif
   ESP_LOGCONFIG(TAG, "  Dump Interval: %ums", this->dump_interval_);
-  ESP_LOGCONFIG(TAG, "  Registered Devices: %zu", this->devices_.size());
+  if (this->dump_interval_ > 0) {
+    size_t cache_bytes = this->detected_devices_.capacity() * sizeof(DetectedDevice) +
+                         this->detected_index_.size() * sizeof(uint16_t);
+    ESP_LOGCONFIG(TAG, "  Discovery Cache: %zu/%u devices, %zu bytes, evicted %u", this->detected_devices_.size(),
+                  this->detected_capacity_, cache_bytes, this->detected_evictions_);
+  }
+#ifdef USE_BTHOME_RECEIVER_METRICS
+  ESP_LOGCONFIG(TAG, "  Pipeline Metrics: every %ums, %u reports seen, %u BTHome", this->metrics_interval_,
+                this->get_reports_seen(), this->get_bthome_reports());
+#endif
+  if (this->pool_capacity_ > 0 && this->compact_pool_) {
+    const CompactDeviceTable &table = this->compact_table_;
+    ESP_LOGCONFIG(TAG, "  Auto-Provision: compact, %u/%u devices, %zu prefixes, %u rejected (pool full)",
+                  table.size(), table.capacity(), this->provision_prefixes_.size(), this->provision_rejections_);
+    ESP_LOGCONFIG(TAG, "    Table: %zu bytes in one block, %zu bytes per device, key slots %u/%u",
+                  table.get_allocated_bytes(), table.get_bytes_per_device(), table.get_key_slots_used(),
+                  table.get_key_slots());
+  } else if (this->pool_capacity_ > 0) {
+    ESP_LOGCONFIG(TAG, "  Auto-Provision: %zu/%u devices, %zu bytes, %zu prefixes, %u rejected (pool full)",
+                  this->pool_.size(), this->pool_capacity_, this->pool_.capacity() * sizeof(BTHomeDevice),
+                  this->provision_prefixes_.size(), this->provision_rejections_);
+  }
+  ESP_LOGCONFIG(TAG, "  Registered Devices: %zu", this->devices_.size() - this->pool_.size());
   for (auto *device : this->devices_) {
+    if (device->is_auto_provisioned()) {
+      continue;
+    }
     uint64_t addr = device->get_mac_address();
-    ESP_LOGCONFIG(TAG, "    MAC: %02X:%02X:%02X:%02X:%02X:%02X",
-                  (uint8_t)((addr >> 40) & 0xFF), (uint8_t)((addr >> 32) & 0xFF),
-                  (uint8_t)((addr >> 24) & 0xFF), (uint8_t)((addr >> 16) & 0xFF),
+    const BTHomeDeviceStats &stats = device->get_stats();
+    ESP_LOGCONFIG(TAG, "    MAC: %02X:%02X:%02X:%02X:%02X:%02X", (uint8_t)((addr >> 40) & 0xFF),
+                  (uint8_t)((addr >> 32) & 0xFF), (uint8_t)((addr >> 24) & 0xFF), (uint8_t)((addr >> 16) & 0xFF),
                   (uint8_t)((addr >> 8) & 0xFF), (uint8_t)(addr & 0xFF));
+    ESP_LOGCONFIG(TAG, "      Packets: %u, duplicates skipped: %u, lost: %u, RSSI: %.1f dBm", stats.packets,
+                  stats.duplicates, stats.lost, device->get_rssi());
+    ESP_LOGCONFIG(TAG, "      Decrypt failures: %u, replays: %u, parse errors: %u", stats.decrypt_failures,
+                  stats.replays, stats.parse_errors);
+    const PacketLayoutCache *layout_cache = device->get_layout_cache();
+    if (layout_cache != nullptr) {
+      ESP_LOGCONFIG(TAG, "      Layout cache: %u hits, %u layouts learned", layout_cache->get_hits(),
+                    layout_cache->get_learned());
+    }
   }
 }
 
 void BTHomeReceiverHub::dump_advertisement_(uint64_t address, const uint8_t *data, size_t len) {
-  // Format MAC address in standard format (MSB first, matches ESPHome config format)
-  char mac_str[18];
-  snprintf(mac_str, sizeof(mac_str), "%02X:%02X:%02X:%02X:%02X:%02X",
-           (uint8_t)((address >> 40) & 0xFF),
-           (uint8_t)((address >> 32) & 0xFF),
-           (uint8_t)((address >> 24) & 0xFF),
-           (uint8_t)((address >> 16) & 0xFF),
-           (uint8_t)((address >> 8) & 0xFF),
-           (uint8_t)(address & 0xFF));
-
   if (len < 1) {
     return;
   }
 
-  // Build raw hex string
-  std::string raw_hex;
-  for (size_t i = 0; i < len; i++) {
-    char hex[4];
-    snprintf(hex, sizeof(hex), "%02X ", data[i]);
-    raw_hex += hex;
-  }
-
   // First byte is device_info
   uint8_t device_info = data[0];
   bool is_encrypted = (device_info & BTHOME_DEVICE_INFO_ENCRYPTED_MASK) != 0;
 
-  // Build measurements string
-  std::string measurements;
+  // Format measurements into a fixed buffer; output is truncated rather than reallocated
+  char measurements[192];
+  size_t out = 0;
+  measurements[0] = '\0';
   size_t pos = 1;  // Skip device_info
+  bthome_codec::DecodedObject obj;
 
-  while (pos < len) {
-    if (pos + 1 > len) break;
-
-    uint8_t object_id = data[pos++];
+  while (out < sizeof(measurements) - 1 &&
+         bthome_codec::next_object(data, len, pos, obj) == bthome_codec::DECODE_OK) {
+    // Events and variable-length data are skipped
+    if (obj.info->kind != bthome_codec::OBJECT_KIND_SENSOR && obj.info->kind != bthome_codec::OBJECT_KIND_BINARY_SENSOR)
+      continue;
 
-    // Get human-readable name
-    const char *name = "?";
-    auto name_it = OBJECT_ID_NAMES.find(object_id);
-    if (name_it != OBJECT_ID_NAMES.end()) {
-      name = name_it->second;
+    int written;
+    const char *sep = out > 0 ? " " : "";
+    if (obj.info->kind == bthome_codec::OBJECT_KIND_BINARY_SENSOR) {
+      written = snprintf(measurements + out, sizeof(measurements) - out, "%s%s=%s", sep, obj.info->name,
+                         obj.payload[0] ? "ON" : "OFF");
+    } else {
+      float value = bthome_codec::decode_raw(obj) * obj.info->factor;
+      written = snprintf(measurements + out, sizeof(measurements) - out, "%s%s=%.2f", sep, obj.info->name, value);
     }
+    if (written < 0)
+      break;
+    out = std::min(out + written, sizeof(measurements) - 1);
+  }
 
-    // Handle special types
-    if (object_id == OBJECT_ID_BUTTON || object_id == OBJECT_ID_DIMMER) {
-      if (pos + 1 > len) break;
-      pos++;
-      continue;
-    }
+  // MAC address in standard format (MSB first, matches ESPHome config format)
+  ESP_LOGI(TAG, "[%02X:%02X:%02X:%02X:%02X:%02X] %s| %s", (uint8_t)((address >> 40) & 0xFF),
+           (uint8_t)((address >> 32) & 0xFF), (uint8_t)((address >> 24) & 0xFF), (uint8_t)((address >> 16) & 0xFF),
+           (uint8_t)((address >> 8) & 0xFF), (uint8_t)(address & 0xFF), is_encrypted ? "ENC " : "", measurements);
+}
 
-    if (object_id == OBJECT_ID_TEXT || object_id == OBJECT_ID_RAW) {
-      if (pos + 1 > len) break;
-      uint8_t str_len = data[pos++];
-      if (pos + str_len > len) break;
-      pos += str_len;
-      continue;
+void BTHomeReceiverHub::loop() {
+#ifdef USE_BTHOME_RECEIVER_NIMBLE
+  // NimBLE bring-up: start the host on the first loop(), then poll for sync without blocking
+  if (this->nimble_state_ == NIMBLE_IDLE) {
+    this->init_nimble_();
+  } else if (this->nimble_state_ == NIMBLE_WAIT_SYNC) {
+    if (this->nimble_synced_.load(std::memory_order_acquire)) {
+      this->nimble_state_ = NIMBLE_READY;
+      ESP_LOGI(TAG, "NimBLE receiver initialized");
+    } else if (esp_timer_get_time() / 1000 - this->nimble_init_time_ > NIMBLE_SYNC_TIMEOUT_MS) {
+      ESP_LOGE(TAG, "Timeout waiting for NimBLE sync");
+      this->nimble_state_ = NIMBLE_FAILED;
+      this->mark_failed();
+      return;
     }
+  }
 
-    auto it = OBJECT_TYPE_MAP.find(object_id);
-    if (it == OBJECT_TYPE_MAP.end()) break;
+  // Drain scan reports queued by the GAP callback, bounded so a burst cannot stall loop()
+  for (size_t i = 0; i < ADV_QUEUE_LOOP_BUDGET; i++) {
+    const RawAdvertisement *adv = this->adv_queue_.front();
+    if (adv == nullptr) {
+      break;
+    }
+#ifdef USE_BTHOME_RECEIVER_METRICS
+    this->record_stage(STAGE_CALLBACK, adv->callback_us);
+    this->record_stage(STAGE_QUEUE, static_cast<uint32_t>(esp_timer_get_time()) - adv->queued_at);
+#endif
+    this->process_nimble_advertisement(*adv);
+    this->adv_queue_.pop();
+    this->schedule_reports_++;
+    this->reports_received_++;
+  }
 
-    const ObjectTypeInfo &type_info = it->second;
-    if (pos + type_info.data_bytes > len) break;
+  if (this->nimble_state_ == NIMBLE_READY) {
+    this->apply_scan_requests_();
+    if (this->adaptive_scan_) {
+      this->update_scan_schedule_(esp_timer_get_time() / 1000);
+    }
+    // The scheduler changed duty or the broadcaster started/stopped advertising: apply the new window
+    if (this->scanning_ && this->scan_window_() != this->active_scan_window_) {
+      this->stop_scanning_();
+      this->start_scanning_();
+    }
+  }
+#endif
 
-    char val_str[32];
-    if (type_info.is_binary_sensor) {
-      snprintf(val_str, sizeof(val_str), "%s=%s", name, data[pos] ? "ON" : "OFF");
-    } else {
-      int32_t raw_value = 0;
-      if (type_info.is_signed) {
-        switch (type_info.data_bytes) {
-          case 1: raw_value = static_cast<int8_t>(data[pos]); break;
-          case 2: raw_value = static_cast<int16_t>(data[pos] | (data[pos + 1] << 8)); break;
-          case 3:
-            raw_value = data[pos] | (data[pos + 1] << 8) | (data[pos + 2] << 16);
-            if (raw_value & 0x800000) raw_value |= 0xFF000000;
-            break;
-          case 4: raw_value = data[pos] | (data[pos + 1] << 8) | (data[pos + 2] << 16) | (data[pos + 3] << 24); break;
-        }
-      } else {
-        switch (type_info.data_bytes) {
-          case 1: raw_value = data[pos]; break;
-          case 2: raw_value = data[pos] | (data[pos + 1] << 8); break;
-          case 3: raw_value = data[pos] | (data[pos + 1] << 8) | (data[pos + 2] << 16); break;
-          case 4: raw_value = data[pos] | (data[pos + 1] << 8) | (data[pos + 2] << 16) | (data[pos + 3] << 24); break;
-        }
+#ifdef USE_SENSOR
+  // Per-device statistics sensors
+  uint32_t stats_now = esp_timer_get_time() / 1000;
+  if (stats_now - this->last_stats_time_ >= STATS_PUBLISH_INTERVAL_MS) {
+    this->last_stats_time_ = stats_now;
+    for (auto *device : this->devices_) {
+      if (device->has_stats_sensors()) {
+        device->publish_stats(stats_now);
       }
-      float value = raw_value * type_info.factor;
-      snprintf(val_str, sizeof(val_str), "%s=%.2f", name, value);
     }
-    if (!measurements.empty()) measurements += " ";
-    measurements += val_str;
-    pos += type_info.data_bytes;
   }
+#endif
 
-  ESP_LOGI(TAG, "[%s] %s| %s", mac_str, is_encrypted ? "ENC " : "", measurements.c_str());
-}
-
-void BTHomeReceiverHub::loop() {
-#ifdef USE_BTHOME_RECEIVER_NIMBLE
-  // Deferred NimBLE initialization - wait for other components to be ready
-  if (!this->nimble_initialized_ && !this->init_attempted_) {
-    // Wait a bit after boot before initializing BLE (use ESP-IDF timer)
-    static int64_t boot_time = esp_timer_get_time();
-    if ((esp_timer_get_time() - boot_time) > 2000000) {  // 2 second delay (microseconds)
-      this->init_attempted_ = true;
-      this->init_nimble_();
-    }
+#ifdef USE_BTHOME_RECEIVER_METRICS
+  uint32_t metrics_now = esp_timer_get_time() / 1000;
+  if (metrics_now - this->last_metrics_time_ >= this->metrics_interval_) {
+    this->report_metrics_(metrics_now);
   }
 #endif
 
-  // Periodic dump of all detected devices
+  // Periodic dump of all detected devices, spread over several loop() iterations
   if (this->dump_interval_ > 0) {
     uint32_t now = esp_timer_get_time() / 1000;  // Convert microseconds to milliseconds
-    if (now - this->last_dump_time_ >= this->dump_interval_) {
+    if (this->dump_cursor_ == DETECTED_NONE && now - this->last_dump_time_ >= this->dump_interval_) {
       this->last_dump_time_ = now;
-      this->dump_all_devices_();
+      this->dump_cursor_ = 0;
+    }
+    if (this->dump_cursor_ != DETECTED_NONE) {
+      this->dump_next_devices_(now);
     }
   }
 }
 
 void BTHomeReceiverHub::register_device(BTHomeDevice *device) {
   this->devices_.push_back(device);
-  ESP_LOGV(TAG, "Registered device: %012llX", device->get_mac_address());
+  ESP_LOGV(TAG, "Registered device: %012llX", static_cast<unsigned long long>(device->get_mac_address()));
+
+  // Devices are normally registered before setup(); keep the index valid for late registrations
+  if (!this->device_index_.empty()) {
+    this->build_device_index_();
+  }
+}
+
+void BTHomeReceiverHub::build_device_index_() {
+  // Room for every pool device up front, so claiming one never rehashes. A compact pool has its own index.
+  size_t pooled = this->compact_pool_ ? 0 : this->pool_capacity_ - this->pool_.size();
+  size_t capacity = 8;
+  while (capacity < (this->devices_.size() + pooled) * 2) {
+    capacity <<= 1;
+  }
+  this->device_index_.assign(capacity, 0);
+  this->device_index_mask_ = capacity - 1;
+
+  for (size_t i = 0; i < this->devices_.size(); i++) {
+    this->index_device_(i);
+  }
+}
+
+void BTHomeReceiverHub::index_device_(size_t pos) {
+  uint64_t address = this->devices_[pos]->get_mac_address();
+  uint32_t slot = hash_mac(address) & this->device_index_mask_;
+  while (this->device_index_[slot] != 0) {
+    // Keep the first registration for a MAC, matching registration order
+    if (this->devices_[this->device_index_[slot] - 1]->get_mac_address() == address) {
+      return;
+    }
+    slot = (slot + 1) & this->device_index_mask_;
+  }
+  this->device_index_[slot] = pos + 1;
+}
+
+bool BTHomeReceiverHub::matches_provision_prefix_(uint64_t address) const {
+  for (const auto &prefix : this->provision_prefixes_) {
+    if ((address & prefix.mask) == prefix.prefix) {
+      return true;
+    }
+  }
+  return false;
+}
+
+BTHomeDevice *BTHomeReceiverHub::provision_device(uint64_t mac) {
+  BTHomeDevice *device = this->find_device_(mac);
+  if (device != nullptr) {
+    return device;
+  }
+  if (this->compact_pool_ || this->pool_.size() >= this->pool_capacity_ || this->device_index_.empty()) {
+    return nullptr;  // Compact, disabled, full, or called before setup() reserved the pool
+  }
+
+  this->pool_.emplace_back(this);
+  device = &this->pool_.back();
+  device->set_mac_address(mac);
+  device->set_auto_provisioned(true);
+  this->devices_.push_back(device);
+  this->index_device_(this->devices_.size() - 1);
+  ESP_LOGI(TAG, "Auto-provisioned %02X:%02X:%02X:%02X:%02X:%02X (%zu/%zu)", (uint8_t)((mac >> 40) & 0xFF),
+           (uint8_t)((mac >> 32) & 0xFF), (uint8_t)((mac >> 24) & 0xFF), (uint8_t)((mac >> 16) & 0xFF),
+           (uint8_t)((mac >> 8) & 0xFF), (uint8_t)(mac & 0xFF), this->pool_.size(), this->pool_.capacity());
+  return device;
+}
+
+bool BTHomeReceiverHub::provision_sender(uint64_t mac) {
+  if (!this->compact_pool_) {
+    return this->provision_device(mac) != nullptr;
+  }
+  uint16_t size = this->compact_table_.size();
+  uint16_t row = this->compact_table_.claim(mac);
+  if (row == CompactDeviceTable::NONE) {
+    return false;  // Full, or called before setup() allocated the table
+  }
+  if (this->compact_table_.size() != size) {
+    ESP_LOGD(TAG, "Auto-provisioned %02X:%02X:%02X:%02X:%02X:%02X (%u/%u)", (uint8_t)((mac >> 40) & 0xFF),
+             (uint8_t)((mac >> 32) & 0xFF), (uint8_t)((mac >> 24) & 0xFF), (uint8_t)((mac >> 16) & 0xFF),
+             (uint8_t)((mac >> 8) & 0xFF), (uint8_t)(mac & 0xFF), this->compact_table_.size(),
+             this->compact_table_.capacity());
+  }
+  return true;
+}
+
+bool BTHomeReceiverHub::provision_sender(uint64_t mac, const std::array<uint8_t, AES_KEY_SIZE> &key) {
+  if (!this->compact_pool_ || !this->provision_sender(mac)) {
+    return false;
+  }
+  uint16_t row = this->compact_table_.find(mac);
+  if (!this->compact_table_.set_key(row, key)) {
+    ESP_LOGW(TAG, "No key slot left for %012llX (%u slots)", static_cast<unsigned long long>(mac),
+             this->compact_table_.get_key_slots());
+    return false;
+  }
+  // A new key starts a new counter sequence
+  this->compact_table_.counter[row] = 0;
+  return true;
+}
+
+void BTHomeReceiverHub::add_measurement_trigger(BTHomeMeasurementTrigger *trigger) {
+  this->measurement_triggers_.push_back(trigger);
+}
+
+void BTHomeReceiverHub::fan_out_measurement(uint64_t mac, uint8_t object_id, uint8_t index, float value) {
+  for (auto *trigger : this->measurement_triggers_) {
+    if (trigger->matches(object_id)) {
+      trigger->trigger(mac, object_id, index, value);
+      this->note_publish();
+    }
+  }
 }
 
 BTHomeDevice *BTHomeReceiverHub::find_device_(uint64_t address) {
-  for (auto *device : this->devices_) {
+  if (this->device_index_.empty()) {
+    return nullptr;
+  }
+  uint32_t slot = hash_mac(address) & this->device_index_mask_;
+  while (this->device_index_[slot] != 0) {
+    BTHomeDevice *device = this->devices_[this->device_index_[slot] - 1];
     if (device->get_mac_address() == address) {
       return device;
     }
+    slot = (slot + 1) & this->device_index_mask_;
   }
   return nullptr;
 }
 
+void BTHomeReceiverHub::allocate_discovery_cache_() {
+  // Arena is reserved once and never grows past detected_capacity_, so slots never move
+  this->detected_devices_.clear();
+  this->detected_devices_.reserve(this->detected_capacity_);
+
+  size_t capacity = 8;
+  while (capacity < static_cast<size_t>(this->detected_capacity_) * 2) {
+    capacity <<= 1;
+  }
+  this->detected_index_.assign(capacity, 0);
+  this->detected_index_mask_ = capacity - 1;
+  this->detected_lru_head_ = DETECTED_NONE;
+  this->detected_lru_tail_ = DETECTED_NONE;
+}
+
+uint32_t BTHomeReceiverHub::find_detected_slot_(uint64_t address) const {
+  // Returns the index slot holding address, or the empty slot where it would be inserted
+  uint32_t slot = hash_mac(address) & this->detected_index_mask_;
+  while (this->detected_index_[slot] != 0) {
+    if (this->detected_devices_[this->detected_index_[slot] - 1].address == address) {
+      break;
+    }
+    slot = (slot + 1) & this->detected_index_mask_;
+  }
+  return slot;
+}
+
+void BTHomeReceiverHub::unlink_detected_(uint16_t pos) {
+  DetectedDevice &dev = this->detected_devices_[pos];
+  if (dev.lru_prev != DETECTED_NONE) {
+    this->detected_devices_[dev.lru_prev].lru_next = dev.lru_next;
+  } else {
+    this->detected_lru_head_ = dev.lru_next;
+  }
+  if (dev.lru_next != DETECTED_NONE) {
+    this->detected_devices_[dev.lru_next].lru_prev = dev.lru_prev;
+  } else {
+    this->detected_lru_tail_ = dev.lru_prev;
+  }
+  dev.lru_prev = DETECTED_NONE;
+  dev.lru_next = DETECTED_NONE;
+}
+
+void BTHomeReceiverHub::remove_detected_index_(uint32_t slot) {
+  // Backward-shift deletion keeps linear probe chains intact without tombstones
+  this->detected_index_[slot] = 0;
+  uint32_t next = (slot + 1) & this->detected_index_mask_;
+  while (this->detected_index_[next] != 0) {
+    uint64_t address = this->detected_devices_[this->detected_index_[next] - 1].address;
+    uint32_t home = hash_mac(address) & this->detected_index_mask_;
+    // Move the entry into the hole unless its home lies cyclically in (slot, next]
+    if (((next - home) & this->detected_index_mask_) >= ((next - slot) & this->detected_index_mask_)) {
+      this->detected_index_[slot] = this->detected_index_[next];
+      this->detected_index_[next] = 0;
+      slot = next;
+    }
+    next = (next + 1) & this->detected_index_mask_;
+  }
+}
+
 void BTHomeReceiverHub::cache_device_data_(uint64_t address, const uint8_t *data, size_t len) {
+  if (this->detected_index_.empty() || this->detected_capacity_ == 0) {
+    return;
+  }
   uint32_t now = esp_timer_get_time() / 1000;
+  if (len > MAX_SERVICE_DATA_SIZE) {
+    len = MAX_SERVICE_DATA_SIZE;
+  }
 
-  // Find existing entry or add new one
-  for (auto &entry : this->detected_devices_) {
-    if (entry.first == address) {
-      entry.second.last_data.assign(data, data + len);
-      entry.second.last_seen = now;
-      return;
+  uint16_t pos;
+  uint32_t slot = this->find_detected_slot_(address);
+  if (this->detected_index_[slot] != 0) {
+    // Known device: move it to the front of the LRU list
+    pos = this->detected_index_[slot] - 1;
+    this->unlink_detected_(pos);
+  } else {
+    if (this->detected_devices_.size() < this->detected_capacity_) {
+      pos = this->detected_devices_.size();
+      this->detected_devices_.emplace_back();
+    } else {
+      // Arena full: reuse the least recently seen device's slot
+      pos = this->detected_lru_tail_;
+      this->unlink_detected_(pos);
+      this->remove_detected_index_(this->find_detected_slot_(this->detected_devices_[pos].address));
+      this->detected_evictions_++;
+      // Removal may have shifted entries, so look up the insertion slot again
+      slot = this->find_detected_slot_(address);
     }
+    this->detected_devices_[pos].address = address;
+    this->detected_index_[slot] = pos + 1;
   }
 
-  // Add new device
-  DetectedDevice dev;
-  dev.last_data.assign(data, data + len);
+  DetectedDevice &dev = this->detected_devices_[pos];
+  memcpy(dev.last_data, data, len);
+  dev.last_data_len = len;
   dev.last_seen = now;
-  this->detected_devices_.emplace_back(address, dev);
-}
 
-void BTHomeReceiverHub::dump_all_devices_() {
-  if (this->detected_devices_.empty()) {
-    return;
+  // Link at the head (most recently seen)
+  dev.lru_next = this->detected_lru_head_;
+  if (this->detected_lru_head_ != DETECTED_NONE) {
+    this->detected_devices_[this->detected_lru_head_].lru_prev = pos;
+  } else {
+    this->detected_lru_tail_ = pos;
   }
+  this->detected_lru_head_ = pos;
+}
 
-  uint32_t now = esp_timer_get_time() / 1000;
+void BTHomeReceiverHub::dump_next_devices_(uint32_t now) {
+  size_t end = std::min(this->detected_devices_.size(), static_cast<size_t>(this->dump_cursor_) + DUMP_DEVICES_PER_LOOP);
 
-  for (const auto &entry : this->detected_devices_) {
-    uint64_t address = entry.first;
-    const DetectedDevice &dev = entry.second;
+  for (size_t i = this->dump_cursor_; i < end; i++) {
+    const DetectedDevice &dev = this->detected_devices_[i];
     uint32_t age_sec = (now - dev.last_seen) / 1000;
 
-    // Check if registered
-    bool is_registered = this->find_device_(address) != nullptr;
-
     // Parse and dump the cached data
-    this->dump_advertisement_(address, dev.last_data.data(), dev.last_data.size());
-    if (is_registered) {
+    this->dump_advertisement_(dev.address, dev.last_data, dev.last_data_len);
+    if (this->find_device_(dev.address) != nullptr) {
       ESP_LOGI(TAG, "  ^ (last seen %us ago) [REGISTERED]", age_sec);
     }
   }
+
+  // Done once every cached device has been emitted
+  this->dump_cursor_ = end < this->detected_devices_.size() ? end : DETECTED_NONE;
+}
+
+#ifdef USE_BTHOME_RECEIVER_METRICS
+void BTHomeReceiverHub::report_metrics_(uint32_t now) {
+  uint32_t elapsed = now - this->last_metrics_time_;
+  uint32_t seen_total = this->get_reports_seen();
+  uint32_t bthome_total = this->get_bthome_reports();
+  uint32_t seen = seen_total - this->metrics_last_seen_;
+  uint32_t bthome = bthome_total - this->metrics_last_bthome_;
+  uint32_t drops_total = 0;
+#ifdef USE_BTHOME_RECEIVER_NIMBLE
+  drops_total = this->get_queue_drops();
+  this->prefilter_latency_.drain_into(this->stage_latency_[STAGE_PREFILTER]);
+#endif
+  uint32_t drops = drops_total - this->metrics_last_drops_;
+  this->last_metrics_time_ = now;
+  this->metrics_last_seen_ = seen_total;
+  this->metrics_last_bthome_ = bthome_total;
+  this->metrics_last_drops_ = drops_total;
+
+  float adv_rate = elapsed > 0 ? seen * 1000.0f / elapsed : 0.0f;
+  float hit_rate = seen > 0 ? 100.0f * bthome / seen : 0.0f;
+  ESP_LOGI(TAG, "Pipeline: %.1f adv/s, BTHome %u/%u (%.1f%%), queue drops %u", adv_rate, bthome, seen, hit_rate,
+           drops);
+  for (uint8_t i = 0; i < STAGE_COUNT; i++) {
+    const LatencyHistogram &latency = this->stage_latency_[i];
+    if (latency.get_count() == 0) {
+      continue;
+    }
+    ESP_LOGI(TAG, "  %-9s n=%u mean=%.0fus p50<=%uus p95<=%uus max=%uus", PIPELINE_STAGE_NAMES[i],
+             latency.get_count(), latency.get_mean(), latency.get_percentile(50), latency.get_percentile(95),
+             latency.get_max());
+  }
+
+#ifdef USE_SENSOR
+  if (this->advertisement_rate_sensor_ != nullptr) {
+    this->advertisement_rate_sensor_->publish_state(adv_rate);
+  }
+  if (this->hit_rate_sensor_ != nullptr && seen > 0) {
+    this->hit_rate_sensor_->publish_state(hit_rate);
+  }
+  if (this->queue_drops_sensor_ != nullptr) {
+    this->queue_drops_sensor_->publish_state(drops_total);
+  }
+  for (uint8_t i = 0; i < STAGE_COUNT; i++) {
+    if (this->stage_latency_sensors_[i] != nullptr && this->stage_latency_[i].get_count() > 0) {
+      this->stage_latency_sensors_[i]->publish_state(this->stage_latency_[i].get_mean());
+    }
+  }
+#endif
+
+  for (auto &latency : this->stage_latency_) {
+    latency.reset();
+  }
+}
+#endif
+
+bool BTHomeReceiverHub::handle_service_data_(uint64_t address, int8_t rssi, const uint8_t *service_data, size_t len) {
+#ifdef USE_BTHOME_RECEIVER_METRICS
+  int64_t lookup_start = esp_timer_get_time();
+#endif
+  // Cache for periodic dump
+  if (this->dump_interval_ > 0) {
+    this->cache_device_data_(address, service_data, len);
+  }
+
+  // Check if this device is registered, or claim a pool slot for a matching sender
+  BTHomeDevice *device = this->find_device_(address);
+  uint16_t row = CompactDeviceTable::NONE;
+  if (device == nullptr && this->compact_pool_) {
+    row = this->compact_table_.find(address);
+  }
+  if (device == nullptr && row == CompactDeviceTable::NONE && this->pool_capacity_ > 0 &&
+      this->matches_provision_prefix_(address)) {
+    if (this->compact_pool_) {
+      row = this->provision_sender(address) ? this->compact_table_.find(address) : CompactDeviceTable::NONE;
+    } else {
+      device = this->provision_device(address);
+    }
+    if (device == nullptr && row == CompactDeviceTable::NONE) {
+      this->provision_rejections_++;
+    }
+  }
+#ifdef USE_BTHOME_RECEIVER_METRICS
+  this->record_stage(STAGE_LOOKUP, esp_timer_get_time() - lookup_start);
+#endif
+  bool handled;
+  if (device != nullptr) {
+    device->record_rssi(rssi);
+    ESP_LOGV(TAG, "Processing BTHome data from registered device %02X:%02X:%02X:%02X:%02X:%02X (%d bytes)",
+             (uint8_t)((address >> 40) & 0xFF), (uint8_t)((address >> 32) & 0xFF),
+             (uint8_t)((address >> 24) & 0xFF), (uint8_t)((address >> 16) & 0xFF), (uint8_t)((address >> 8) & 0xFF),
+             (uint8_t)(address & 0xFF), (int)len);
+    handled = device->parse_advertisement(service_data, len);
+  } else if (row != CompactDeviceTable::NONE) {
+    this->compact_table_.rssi[row] = rssi;
+    handled = this->parse_compact_(row, service_data, len);
+  } else {
+    return false;
+  }
+  return handled;
+}
+
+void BTHomeReceiverHub::note_first_publish_() {
+  this->first_publish_ms_ = esp_timer_get_time() / 1000;
+  ESP_LOGI(TAG, "First BTHome value published %ums after boot", this->first_publish_ms_);
+}
+
+bool BTHomeReceiverHub::parse_compact_(uint16_t row, const uint8_t *service_data, size_t len) {
+  CompactDeviceTable &table = this->compact_table_;
+  uint64_t mac = table.mac[row];
+  if (len < 1) {
+    add_saturating(table.errors[row], 1);
+    return false;
+  }
+
+  DedupState dedup_key = make_dedup_key(service_data, len);
+  if (is_duplicate_packet(table.dedup[row], dedup_key)) {
+    return true;
+  }
+
+  uint8_t device_info = service_data[0];
+  const uint8_t *payload_data = service_data + 1;
+  size_t payload_len = len - 1;
+  uint8_t decrypted_buffer[MAX_SERVICE_DATA_SIZE];
+  uint32_t counter_gap = 0;
+
+  if (device_info & BTHOME_DEVICE_INFO_ENCRYPTED_MASK) {
+    // Encrypted format: device_info(1) + ciphertext + counter(4) + MIC(4)
+    mbedtls_ccm_context *key = table.get_key(row);
+    if (key == nullptr || len < 9) {
+      ESP_LOGV(TAG, "%012llX: encrypted data without a key slot, or too short", static_cast<unsigned long long>(mac));
+      add_saturating(table.errors[row], 1);
+      return false;
+    }
+    size_t counter_offset = len - 8;
+    uint32_t counter = service_data[counter_offset] | (service_data[counter_offset + 1] << 8) |
+                       (service_data[counter_offset + 2] << 16) | (service_data[counter_offset + 3] << 24);
+    if (counter <= table.counter[row]) {
+      ESP_LOGV(TAG, "%012llX: counter not increased: %u <= %u", static_cast<unsigned long long>(mac), counter,
+               table.counter[row]);
+      add_saturating(table.errors[row], 1);
+      return false;
+    }
+
+    // Nonce prefix: MAC(6, little-endian) + UUID(2, little-endian), built per packet instead of stored per row
+    uint8_t nonce_prefix[8];
+    for (int i = 0; i < 6; i++) {
+      nonce_prefix[i] = (mac >> (i * 8)) & 0xFF;
+    }
+    nonce_prefix[6] = bthome_codec::SERVICE_UUID & 0xFF;
+    nonce_prefix[7] = (bthome_codec::SERVICE_UUID >> 8) & 0xFF;
+
+    size_t plaintext_len;
+#ifdef USE_BTHOME_RECEIVER_METRICS
+    int64_t decrypt_start = esp_timer_get_time();
+#endif
+    bool decrypted = decrypt_bthome_payload(key, nonce_prefix, service_data + 1, len - 1, device_info, counter,
+                                            decrypted_buffer, &plaintext_len);
+#ifdef USE_BTHOME_RECEIVER_METRICS
+    this->record_stage(STAGE_DECRYPT, esp_timer_get_time() - decrypt_start);
+#endif
+    if (!decrypted) {
+      add_saturating(table.errors[row], 1);
+      return false;
+    }
+    if (table.counter[row] != 0) {
+      counter_gap = counter - table.counter[row] - 1;
+    }
+    table.counter[row] = counter;
+    payload_data = decrypted_buffer;
+    payload_len = plaintext_len;
+  }
+  // Only a packet that passed decryption and the counter check becomes the dedup reference
+  uint32_t gap = commit_packet(table.dedup[row], dedup_key) + counter_gap;
+  table.packets[row]++;
+  if (gap > 0 && gap <= MAX_COUNTED_PACKET_GAP) {
+    add_saturating(table.lost[row], gap);
+  }
+
+  // Compact senders have no entities: every numeric and binary object goes to the measurement triggers
+  size_t pos = 0;
+  bthome_codec::DecodedObject obj;
+  ObjectOccurrences occurrences;
+  while (true) {
+    bthome_codec::DecodeStatus status = bthome_codec::next_object(payload_data, payload_len, pos, obj);
+    if (status == bthome_codec::DECODE_END) {
+      break;
+    }
+    if (status != bthome_codec::DECODE_OK) {
+      ESP_LOGV(TAG, "%012llX: cannot decode object 0x%02X", static_cast<unsigned long long>(mac), obj.object_id);
+      add_saturating(table.errors[row], 1);
+      break;
+    }
+    uint8_t index = occurrences.next(obj.object_id);
+    if (obj.info->kind == bthome_codec::OBJECT_KIND_SENSOR && obj.object_id != bthome_codec::OBJECT_ID_PACKET_ID) {
+      this->fan_out_measurement(mac, obj.object_id, index, bthome_codec::decode_raw(obj) * obj.info->factor);
+    } else if (obj.info->kind == bthome_codec::OBJECT_KIND_BINARY_SENSOR) {
+      this->fan_out_measurement(mac, obj.object_id, 0, obj.payload[0] != 0 ? 1.0f : 0.0f);
+    }
+  }
+  return true;
 }
 
 // ============================================================================
@@ -481,44 +738,81 @@ void BTHomeReceiverHub::dump_all_devices_() {
 
 #ifdef USE_BTHOME_RECEIVER_NIMBLE
 
-void BTHomeReceiverHub::nimble_host_task_(void *param) {
-  ESP_LOGI(TAG, "NimBLE host task started");
-  nimble_port_run();
-  nimble_port_freertos_deinit();
+// Host task callbacks only post requests; loop() owns scanning_, the accept list and every
+// ble_gap_disc()/ble_gap_disc_cancel() call.
+void BTHomeReceiverHub::on_host_sync() {
+  this->scan_requests_.fetch_or(SCAN_REQUEST_SYNC, std::memory_order_release);
+  this->nimble_synced_.store(true, std::memory_order_release);
 }
 
-void BTHomeReceiverHub::nimble_on_sync_() {
-  ESP_LOGI(TAG, "NimBLE host-controller synchronized");
+void BTHomeReceiverHub::on_host_reset(int reason) {
+  this->scan_requests_.fetch_or(SCAN_REQUEST_RESET, std::memory_order_release);
+}
 
-  // Signal that sync is complete
-  if (nimble_sync_semaphore_ != nullptr) {
-    xSemaphoreGive(nimble_sync_semaphore_);
+void BTHomeReceiverHub::apply_scan_requests_() {
+  uint8_t requests = this->scan_requests_.exchange(0, std::memory_order_acquire);
+  if (requests == 0) {
+    return;
   }
-
-  // Start scanning
-  if (instance_ != nullptr) {
-    instance_->start_scanning_();
+  // Every request means discovery is no longer running
+  this->scanning_ = false;
+  if (requests & (SCAN_REQUEST_SYNC | SCAN_REQUEST_RESET)) {
+    this->accept_list_programmed_ = false;
+  }
+  // After a reset the host is not synced yet; the next sync posts a new request
+  if (bthome_nimble::NimBLEHost::is_synced()) {
+    this->start_scanning_();
   }
-}
-
-void BTHomeReceiverHub::nimble_on_reset_(int reason) {
-  ESP_LOGW(TAG, "NimBLE host reset, reason: %d", reason);
 }
 
 int BTHomeReceiverHub::nimble_gap_event_(struct ble_gap_event *event, void *arg) {
   switch (event->type) {
-    case BLE_GAP_EVENT_DISC:
-      // Advertisement received
-      if (instance_ != nullptr) {
-        instance_->process_nimble_advertisement(&event->disc);
+    case BLE_GAP_EVENT_DISC: {
+      // Advertisement received - runs on the NimBLE host task, so only copy the BTHome service data
+      // into the queue here. Decryption, parsing and publishing happen in loop().
+      if (instance_ == nullptr) {
+        break;
+      }
+#ifdef USE_BTHOME_RECEIVER_METRICS
+      int64_t callback_start = esp_timer_get_time();
+      instance_->reports_seen_.fetch_add(1, std::memory_order_relaxed);
+#endif
+      // Most reports are phones, beacons and TVs: reject them before touching the queue
+      const uint8_t *service_data;
+      size_t service_data_len;
+      if (event->disc.length_data > MAX_ADV_DATA_SIZE ||
+          !bthome_codec::find_service_data(event->disc.data, event->disc.length_data, service_data,
+                                           service_data_len)) {
+#ifdef USE_BTHOME_RECEIVER_METRICS
+        instance_->prefilter_latency_.record(esp_timer_get_time() - callback_start);
+#endif
+        break;
+      }
+#ifdef USE_BTHOME_RECEIVER_METRICS
+      instance_->bthome_reports_.fetch_add(1, std::memory_order_relaxed);
+#endif
+      RawAdvertisement *adv = instance_->adv_queue_.prepare_push();
+      if (adv == nullptr) {
+        break;  // Queue full, counted as a drop
       }
+      memcpy(adv->address, event->disc.addr.val, sizeof(adv->address));
+      adv->rssi = event->disc.rssi;
+      adv->data_len = service_data_len;
+      memcpy(adv->data, service_data, service_data_len);
+#ifdef USE_BTHOME_RECEIVER_METRICS
+      int64_t queued_at = esp_timer_get_time();
+      adv->queued_at = static_cast<uint32_t>(queued_at);
+      adv->callback_us = std::min<int64_t>(queued_at - callback_start, UINT16_MAX);
+#endif
+      instance_->adv_queue_.commit_push();
       break;
+    }
 
     case BLE_GAP_EVENT_DISC_COMPLETE:
-      // Discovery completed - restart scanning
+      // Discovery completed - loop() restarts scanning
       ESP_LOGD(TAG, "Scan complete, restarting...");
       if (instance_ != nullptr) {
-        instance_->start_scanning_();
+        instance_->scan_requests_.fetch_or(SCAN_REQUEST_COMPLETE, std::memory_order_release);
       }
       break;
 
@@ -538,12 +832,16 @@ void BTHomeReceiverHub::start_scanning_() {
 
   // Passive scanning (don't send scan requests)
   disc_params.passive = 1;
-  // Filter duplicates disabled to receive all advertisements
-  disc_params.filter_duplicates = 0;
-  // Scan interval and window (in 0.625ms units)
-  // 160 = 100ms interval, 80 = 50ms window
-  disc_params.itvl = 160;
-  disc_params.window = 80;
+  // Without controller filtering every advertisement is forwarded to the host. With it, the
+  // controller drops repeats of the same address + data (retransmissions) and, unless we are
+  // discovering or auto-provisioning devices, anything not on the accept list.
+  disc_params.filter_duplicates = this->controller_filter_ ? 1 : 0;
+  bool use_accept_list = this->controller_filter_ && this->dump_interval_ == 0 && this->pool_capacity_ == 0 &&
+                         this->program_accept_list_();
+  disc_params.filter_policy = use_accept_list ? BLE_HCI_SCAN_FILT_USE_WL : BLE_HCI_SCAN_FILT_NO_WL;
+  // Scan interval and window (in 0.625ms units), window picked by the scan scheduler
+  disc_params.itvl = SCAN_INTERVAL;
+  disc_params.window = this->scan_window_();
   // Limited discovery mode disabled
   disc_params.limited = 0;
 
@@ -554,7 +852,12 @@ void BTHomeReceiverHub::start_scanning_() {
   }
 
   this->scanning_ = true;
-  ESP_LOGI(TAG, "BLE scanning started");
+  this->active_scan_window_ = disc_params.window;
+  if (this->first_scan_ms_ == 0) {
+    this->first_scan_ms_ = esp_timer_get_time() / 1000;
+    ESP_LOGI(TAG, "Scanning %ums after boot", this->first_scan_ms_);
+  }
+  ESP_LOGD(TAG, "BLE scanning started (duty %u%%)", this->get_scan_duty_percent());
 }
 
 void BTHomeReceiverHub::stop_scanning_() {
@@ -564,64 +867,105 @@ void BTHomeReceiverHub::stop_scanning_() {
 
   ble_gap_disc_cancel();
   this->scanning_ = false;
-  ESP_LOGI(TAG, "BLE scanning stopped");
+  ESP_LOGD(TAG, "BLE scanning stopped");
 }
 
-void BTHomeReceiverHub::process_nimble_advertisement(const struct ble_gap_disc_desc *disc) {
-  // Convert address to uint64_t (little-endian)
-  uint64_t address = 0;
-  for (int i = 0; i < 6; i++) {
-    address |= static_cast<uint64_t>(disc->addr.val[i]) << (i * 8);
+bool BTHomeReceiverHub::program_accept_list_() {
+  if (this->accept_list_programmed_) {
+    return true;
+  }
+  if (this->accept_list_failed_ || this->devices_.empty()) {
+    return false;
   }
 
-  // Parse advertisement data to find BTHome service data
-  const uint8_t *data = disc->data;
-  uint8_t data_len = disc->length_data;
-
-  // Parse AD structures
-  size_t pos = 0;
-  while (pos < data_len) {
-    if (pos + 1 > data_len) break;
-
-    uint8_t len = data[pos];
-    if (len == 0 || pos + 1 + len > data_len) break;
-
-    uint8_t ad_type = data[pos + 1];
-    const uint8_t *ad_data = &data[pos + 2];
-    uint8_t ad_data_len = len - 1;
+  // The address type isn't known from the config, so each MAC is listed as public and random
+  std::vector<ble_addr_t> addrs;
+  addrs.reserve(this->devices_.size() * 2);
+  for (auto *device : this->devices_) {
+    if (this->find_device_(device->get_mac_address()) != device) {
+      continue;  // Same MAC registered by another platform
+    }
+    ble_addr_t addr;
+    for (int i = 0; i < 6; i++) {
+      addr.val[i] = (device->get_mac_address() >> (i * 8)) & 0xFF;
+    }
+    addr.type = BLE_ADDR_PUBLIC;
+    addrs.push_back(addr);
+    addr.type = BLE_ADDR_RANDOM;
+    addrs.push_back(addr);
+  }
 
-    // AD type 0x16 = Service Data - 16-bit UUID
-    if (ad_type == 0x16 && ad_data_len >= 2) {
-      // Extract 16-bit UUID (little-endian)
-      uint16_t uuid = ad_data[0] | (ad_data[1] << 8);
+  int rc = ble_gap_wl_set(addrs.data(), addrs.size());
+  if (rc != 0) {
+    ESP_LOGW(TAG, "Failed to program accept list with %zu entries (rc=%d), scanning unfiltered", addrs.size(), rc);
+    this->accept_list_failed_ = true;
+    return false;
+  }
+  this->accept_list_programmed_ = true;
+  ESP_LOGD(TAG, "Accept list programmed with %zu entries", addrs.size());
+  return true;
+}
 
-      if (uuid == BTHOME_SERVICE_UUID) {
-        // Found BTHome service data (excluding the 2-byte UUID prefix)
-        const uint8_t *service_data = ad_data + 2;
-        size_t service_data_len = ad_data_len - 2;
+void BTHomeReceiverHub::update_scan_schedule_(uint32_t now) {
+  uint32_t elapsed = now - this->last_schedule_time_;
+  if (elapsed < SCAN_SCHEDULE_PERIOD_MS) {
+    return;
+  }
+  this->scan_duty_time_[this->scan_duty_] += elapsed;
+  this->last_schedule_time_ = now;
 
-        // Cache for periodic dump
-        if (this->dump_interval_ > 0) {
-          this->cache_device_data_(address, service_data, service_data_len);
-        }
+  ScanDuty duty = this->choose_scan_duty_(now);
+  this->schedule_reports_ = 0;
+  if (duty == this->scan_duty_) {
+    return;
+  }
 
-        // Check if this device is registered
-        BTHomeDevice *device = this->find_device_(address);
-        if (device != nullptr) {
-          std::vector<uint8_t> service_data_vec(service_data, service_data + service_data_len);
-          ESP_LOGV(TAG, "Processing BTHome data from registered device %02X:%02X:%02X:%02X:%02X:%02X (%d bytes)",
-                   (uint8_t)((address >> 40) & 0xFF), (uint8_t)((address >> 32) & 0xFF),
-                   (uint8_t)((address >> 24) & 0xFF), (uint8_t)((address >> 16) & 0xFF),
-                   (uint8_t)((address >> 8) & 0xFF), (uint8_t)(address & 0xFF),
-                   (int)service_data_vec.size());
-          device->parse_advertisement(service_data_vec);
-        }
-        return;
-      }
+  ESP_LOGV(TAG, "Scan duty %u%% -> %u%%", this->get_scan_duty_percent(), SCAN_WINDOWS[duty] * 100 / SCAN_INTERVAL);
+  this->scan_duty_ = duty;
+  this->scan_duty_changes_++;
+  // Scan parameters can only be changed by restarting discovery, which loop() does when the window changes
+}
+
+ScanDuty BTHomeReceiverHub::choose_scan_duty_(uint32_t now) {
+  if (this->schedule_reports_ >= SCAN_BURST_THRESHOLD) {
+    return SCAN_DUTY_HIGH;
+  }
+
+  // Discovery and a pool with free slots need to see unknown devices, so never drop below normal duty
+  bool learning = this->dump_interval_ > 0 || this->get_provisioned_count() < this->pool_capacity_;
+  for (auto *device : this->devices_) {
+    // Only the first device registered for a MAC receives packets
+    if (this->find_device_(device->get_mac_address()) != device) {
+      continue;
     }
+    uint32_t interval = device->get_advertising_interval();
+    if (interval == 0) {
+      learning = true;
+      continue;
+    }
+    uint32_t since = now - device->get_last_seen();
+    if (since > interval * SCAN_ABSENT_FACTOR) {
+      // Missed several packets: the estimate is stale, fall back to searching
+      learning = true;
+      continue;
+    }
+    uint32_t margin = std::max(interval / 8, SCAN_DUE_MARGIN_MS);
+    if (since + margin >= interval) {
+      return SCAN_DUTY_HIGH;
+    }
+  }
+  return learning ? SCAN_DUTY_NORMAL : SCAN_DUTY_LOW;
+}
 
-    pos += 1 + len;
+void BTHomeReceiverHub::process_nimble_advertisement(const RawAdvertisement &adv) {
+  // Convert address to uint64_t (little-endian)
+  uint64_t address = 0;
+  for (int i = 0; i < 6; i++) {
+    address |= static_cast<uint64_t>(adv.address[i]) << (i * 8);
   }
+
+  // The GAP callback only queues BTHome service data (after the UUID)
+  this->handle_service_data_(address, adv.rssi, adv.data, adv.data_len);
 }
 
 #endif  // USE_BTHOME_RECEIVER_NIMBLE
@@ -632,52 +976,339 @@ void BTHomeReceiverHub::process_nimble_advertisement(const struct ble_gap_disc_d
 
 #ifdef USE_BTHOME_RECEIVER_BLUEDROID
 
-bool BTHomeReceiverHub::parse_device(const esphome::esp32_ble_tracker::ESPBTDevice &device) {
-  // Check if this device has BTHome service data (UUID 0xFCD2)
-  for (const auto &service_data : device.get_service_datas()) {
-    if (service_data.uuid.get_uuid().uuid.uuid16 == BTHOME_SERVICE_UUID) {
-      // Look up registered device by MAC address
-      uint64_t address = device.address_uint64();
-
-      // Cache for periodic dump
-      if (this->dump_interval_ > 0) {
-        this->cache_device_data_(address, service_data.data.data(), service_data.data.size());
-      }
+bool BTHomeReceiverHub::parse_devices(const esphome::esp32_ble::BLEScanResult *scan_results, size_t count) {
+  // Raw scan results straight from the tracker's batch: prefilter on the AD bytes, so nothing is
+  // built for the (many) reports that are not BTHome
+  bool handled = false;
+  for (size_t i = 0; i < count; i++) {
+    const esphome::esp32_ble::BLEScanResult &result = scan_results[i];
+#ifdef USE_BTHOME_RECEIVER_METRICS
+    int64_t callback_start = esp_timer_get_time();
+    this->reports_seen_.fetch_add(1, std::memory_order_relaxed);
+#endif
+    size_t adv_len = std::min<size_t>(result.adv_data_len + result.scan_rsp_len, sizeof(result.ble_adv));
+    const uint8_t *service_data;
+    size_t service_data_len;
+    if (!bthome_codec::find_service_data(result.ble_adv, adv_len, service_data, service_data_len)) {
+#ifdef USE_BTHOME_RECEIVER_METRICS
+      this->record_stage(STAGE_PREFILTER, esp_timer_get_time() - callback_start);
+#endif
+      continue;
+    }
+#ifdef USE_BTHOME_RECEIVER_METRICS
+    this->bthome_reports_.fetch_add(1, std::memory_order_relaxed);
+    this->record_stage(STAGE_CALLBACK, esp_timer_get_time() - callback_start);
+#endif
 
-      BTHomeDevice *device = this->find_device_(address);
-      if (device != nullptr) {
-        ESP_LOGV(TAG, "Processing BTHome advertisement from %012llX", address);
-        return device->parse_advertisement(service_data.data);
-      }
-      return false;
+    // bda is most significant byte first
+    uint64_t address = 0;
+    for (int j = 0; j < 6; j++) {
+      address = (address << 8) | result.bda[j];
     }
+    handled |= this->handle_service_data_(address, static_cast<int8_t>(result.rssi), service_data, service_data_len);
   }
+  return handled;
+}
+
+bool BTHomeReceiverHub::parse_device(const esphome::esp32_ble_tracker::ESPBTDevice &device) {
+  // The hub always declares RAW_ADVERTISEMENTS, so every report arrives through parse_devices().
+  // When another component uses parsed mode, esp32_ble_tracker calls both parse_devices() and
+  // parse_device() for each listener; handling the report here as well would count and publish it
+  // twice.
   return false;
 }
 
 #endif  // USE_BTHOME_RECEIVER_BLUEDROID
 
+// ============================================================================
+// Shared packet helpers
+// ============================================================================
+
+DedupState make_dedup_key(const uint8_t *service_data, size_t len) {
+  DedupState key;
+  bool is_encrypted = (service_data[0] & BTHOME_DEVICE_INFO_ENCRYPTED_MASK) != 0;
+
+  // Unencrypted packets carry packet_id as the first object (objects are sorted by ID)
+  if (!is_encrypted && len >= 3 && service_data[1] == bthome_codec::OBJECT_ID_PACKET_ID) {
+    key.has_packet_id = true;
+    key.last_packet_id = service_data[2];
+    return key;
+  }
+
+  // Fallback: FNV-1a over the whole service data (for encrypted packets this covers counter and MIC)
+  uint32_t hash = 2166136261UL;
+  for (size_t i = 0; i < len; i++) {
+    hash ^= service_data[i];
+    hash *= 16777619UL;
+  }
+  key.fingerprint = hash;
+  key.fingerprint_len = len > 0xFF ? 0xFF : len;
+  return key;
+}
+
+bool is_duplicate_packet(const DedupState &state, const DedupState &key) {
+  if (key.has_packet_id) {
+    return state.has_packet_id && key.last_packet_id == state.last_packet_id;
+  }
+  return key.fingerprint_len == state.fingerprint_len && key.fingerprint == state.fingerprint;
+}
+
+uint32_t commit_packet(DedupState &state, const DedupState &key) {
+  uint32_t gap = 0;
+  if (key.has_packet_id && state.has_packet_id) {
+    gap = static_cast<uint8_t>(key.last_packet_id - state.last_packet_id - 1);
+  }
+  state = key;
+  return gap;
+}
+
+bool decrypt_bthome_payload(mbedtls_ccm_context *ctx, const uint8_t *nonce_prefix, const uint8_t *data,
+                            size_t data_len, uint8_t device_info, uint32_t counter, uint8_t *plaintext,
+                            size_t *plaintext_len) {
+  // Nonce: MAC(6) + UUID(2, little-endian) + device_info(1) + counter(4) = 13 bytes
+  uint8_t nonce[13];
+  memcpy(nonce, nonce_prefix, 8);
+  nonce[8] = device_info;
+  nonce[9] = counter & 0xFF;
+  nonce[10] = (counter >> 8) & 0xFF;
+  nonce[11] = (counter >> 16) & 0xFF;
+  nonce[12] = (counter >> 24) & 0xFF;
+
+  // data ends with the counter (4 bytes) and the MIC (4 bytes)
+  if (data_len < 8) {
+    ESP_LOGE(TAG, "Encrypted data too short for counter and MIC");
+    return false;
+  }
+
+  size_t ciphertext_len = data_len - 8;
+  const uint8_t *mic = data + data_len - 4;
+
+  int ret = mbedtls_ccm_auth_decrypt(ctx, ciphertext_len, nonce, sizeof(nonce), nullptr, 0, data, plaintext, mic, 4);
+  if (ret != 0) {
+    ESP_LOGE(TAG, "mbedtls_ccm_auth_decrypt failed: %d", ret);
+    return false;
+  }
+
+  *plaintext_len = ciphertext_len;
+  return true;
+}
+
+// ============================================================================
+// CompactDeviceTable Implementation
+// ============================================================================
+
+bool CompactDeviceTable::allocate(uint16_t capacity, uint16_t key_slots, bool psram) {
+  size_t index_size = 8;
+  while (index_size < static_cast<size_t>(capacity) * 2) {
+    index_size <<= 1;
+  }
+
+  // Offset of each array in the block, aligned for its element type
+  size_t offset = 0;
+  auto place = [&offset](size_t align, size_t bytes) {
+    offset = (offset + align - 1) / align * align;
+    size_t at = offset;
+    offset += bytes;
+    return at;
+  };
+  size_t keys_at = place(alignof(mbedtls_ccm_context), key_slots * sizeof(mbedtls_ccm_context));
+  size_t mac_at = place(alignof(uint64_t), capacity * sizeof(uint64_t));
+  size_t dedup_at = place(alignof(DedupState), capacity * sizeof(DedupState));
+  size_t counter_at = place(alignof(uint32_t), capacity * sizeof(uint32_t));
+  size_t packets_at = place(alignof(uint32_t), capacity * sizeof(uint32_t));
+  size_t lost_at = place(alignof(uint16_t), capacity * sizeof(uint16_t));
+  size_t errors_at = place(alignof(uint16_t), capacity * sizeof(uint16_t));
+  size_t key_slot_at = place(alignof(uint16_t), capacity * sizeof(uint16_t));
+  size_t index_at = place(alignof(uint16_t), index_size * sizeof(uint16_t));
+  size_t rssi_at = place(alignof(int8_t), capacity * sizeof(int8_t));
+
+  // NONE lets the allocator prefer PSRAM and fall back to internal RAM
+  RAMAllocator<uint8_t> allocator(psram ? RAMAllocator<uint8_t>::NONE : RAMAllocator<uint8_t>::ALLOC_INTERNAL);
+  this->block_ = allocator.allocate(offset);
+  if (this->block_ == nullptr) {
+    return false;
+  }
+  // All-zero is the initial state of every array except the key slot indexes
+  memset(this->block_, 0, offset);
+  memset(this->block_ + key_slot_at, 0xFF, capacity * sizeof(uint16_t));
+
+  this->keys_ = reinterpret_cast<mbedtls_ccm_context *>(this->block_ + keys_at);
+  this->mac = reinterpret_cast<uint64_t *>(this->block_ + mac_at);
+  this->dedup = reinterpret_cast<DedupState *>(this->block_ + dedup_at);
+  this->counter = reinterpret_cast<uint32_t *>(this->block_ + counter_at);
+  this->packets = reinterpret_cast<uint32_t *>(this->block_ + packets_at);
+  this->lost = reinterpret_cast<uint16_t *>(this->block_ + lost_at);
+  this->errors = reinterpret_cast<uint16_t *>(this->block_ + errors_at);
+  this->key_slot_ = reinterpret_cast<uint16_t *>(this->block_ + key_slot_at);
+  this->index_ = reinterpret_cast<uint16_t *>(this->block_ + index_at);
+  this->rssi = reinterpret_cast<int8_t *>(this->block_ + rssi_at);
+
+  this->allocated_bytes_ = offset;
+  this->capacity_ = capacity;
+  this->key_slots_ = key_slots;
+  this->index_mask_ = index_size - 1;
+  return true;
+}
+
+size_t CompactDeviceTable::get_bytes_per_device() const {
+  if (this->capacity_ == 0) {
+    return 0;
+  }
+  return (this->allocated_bytes_ - this->key_slots_ * sizeof(mbedtls_ccm_context)) / this->capacity_;
+}
+
+uint16_t CompactDeviceTable::find(uint64_t mac) const {
+  if (this->index_ == nullptr) {
+    return NONE;
+  }
+  uint32_t slot = hash_mac(mac) & this->index_mask_;
+  while (this->index_[slot] != 0) {
+    uint16_t row = this->index_[slot] - 1;
+    if (this->mac[row] == mac) {
+      return row;
+    }
+    slot = (slot + 1) & this->index_mask_;
+  }
+  return NONE;
+}
+
+uint16_t CompactDeviceTable::claim(uint64_t mac) {
+  if (this->index_ == nullptr) {
+    return NONE;
+  }
+  uint32_t slot = hash_mac(mac) & this->index_mask_;
+  while (this->index_[slot] != 0) {
+    uint16_t row = this->index_[slot] - 1;
+    if (this->mac[row] == mac) {
+      return row;
+    }
+    slot = (slot + 1) & this->index_mask_;
+  }
+  if (this->size_ >= this->capacity_) {
+    return NONE;
+  }
+  // The index has at least twice as many slots as rows, so the probe above always ends on a free slot
+  uint16_t row = this->size_++;
+  this->mac[row] = mac;
+  this->index_[slot] = row + 1;
+  return row;
+}
+
+bool CompactDeviceTable::set_key(uint16_t row, const std::array<uint8_t, AES_KEY_SIZE> &key) {
+  uint16_t slot = this->key_slot_[row];
+  if (slot == NONE) {
+    if (this->keys_used_ >= this->key_slots_) {
+      return false;
+    }
+    slot = this->keys_used_++;
+  } else {
+    mbedtls_ccm_free(&this->keys_[slot]);
+  }
+  mbedtls_ccm_init(&this->keys_[slot]);
+
+  int ret = mbedtls_ccm_setkey(&this->keys_[slot], MBEDTLS_CIPHER_ID_AES, key.data(), 128);
+  if (ret != 0) {
+    ESP_LOGE(TAG, "mbedtls_ccm_setkey failed: %d", ret);
+    mbedtls_ccm_free(&this->keys_[slot]);
+    this->key_slot_[row] = NONE;
+    return false;
+  }
+  this->key_slot_[row] = slot;
+  return true;
+}
+
 // ============================================================================
 // BTHomeDevice Implementation
 // ============================================================================
 
+void BTHomeDevice::set_mac_address(uint64_t mac) {
+  this->address_ = mac;
+
+  // Precompute the constant part of the CCM nonce: MAC(6) + UUID(2)
+  for (int i = 0; i < 6; i++) {
+    this->nonce_prefix_[i] = (mac >> (i * 8)) & 0xFF;
+  }
+  this->nonce_prefix_[6] = bthome_codec::SERVICE_UUID & 0xFF;         // 0xD2
+  this->nonce_prefix_[7] = (bthome_codec::SERVICE_UUID >> 8) & 0xFF;  // 0xFC
+}
+
 void BTHomeDevice::set_encryption_key(const std::array<uint8_t, 16> &key) {
+  // The key never changes, so expand it once here instead of on every packet
+  if (this->encryption_enabled_) {
+    mbedtls_ccm_free(&this->ccm_ctx_);
+  }
+  mbedtls_ccm_init(&this->ccm_ctx_);
+
+  int ret = mbedtls_ccm_setkey(&this->ccm_ctx_, MBEDTLS_CIPHER_ID_AES, key.data(), 128);
+  if (ret != 0) {
+    ESP_LOGE(TAG, "mbedtls_ccm_setkey failed: %d", ret);
+    mbedtls_ccm_free(&this->ccm_ctx_);
+    this->encryption_enabled_ = false;
+    return;
+  }
   this->encryption_enabled_ = true;
-  this->encryption_key_ = key;
 }
 
-bool BTHomeDevice::parse_advertisement(const std::vector<uint8_t> &service_data) {
-  if (service_data.size() < 1) {
+void BTHomeDevice::note_packet_(uint32_t now) {
+  if (this->seen_) {
+    uint32_t gap = now - this->last_seen_;
+    if (this->adv_interval_ == 0) {
+      this->adv_interval_ = gap;
+    } else {
+      // Exponential moving average with weight 1/4, so a single missed packet only nudges the estimate
+      this->adv_interval_ = this->adv_interval_ - this->adv_interval_ / 4 + gap / 4;
+    }
+  }
+  this->seen_ = true;
+  this->last_seen_ = now;
+}
+
+void BTHomeDevice::record_rssi(int8_t rssi) {
+  int16_t sample = static_cast<int16_t>(rssi) * 16;
+  if (!this->stats_.has_rssi) {
+    this->stats_.rssi_x16 = sample;
+    this->stats_.has_rssi = true;
+  } else {
+    // Exponential moving average with weight 1/8
+    this->stats_.rssi_x16 += (sample - this->stats_.rssi_x16) / 8;
+  }
+}
+
+#ifdef USE_SENSOR
+void BTHomeDevice::publish_stats(uint32_t now) {
+  uint32_t elapsed = now - this->stats_last_time_;
+  uint32_t packets = this->stats_.packets - this->stats_last_packets_;
+  uint32_t lost = this->stats_.lost - this->stats_last_lost_;
+  this->stats_last_time_ = now;
+  this->stats_last_packets_ = this->stats_.packets;
+  this->stats_last_lost_ = this->stats_.lost;
+
+  if (this->rssi_sensor_ != nullptr && this->stats_.has_rssi) {
+    this->rssi_sensor_->publish_state(this->get_rssi());
+  }
+  if (this->packet_rate_sensor_ != nullptr && elapsed > 0) {
+    this->packet_rate_sensor_->publish_state(packets * 60000.0f / elapsed);
+  }
+  if (this->packet_loss_sensor_ != nullptr && packets + lost > 0) {
+    this->packet_loss_sensor_->publish_state(100.0f * lost / (packets + lost));
+  }
+}
+#endif
+
+bool BTHomeDevice::parse_advertisement(const uint8_t *service_data, size_t len) {
+  if (len < 1) {
     ESP_LOGW(TAG, "Invalid service data: too short");
+    this->stats_.parse_errors++;
     return false;
   }
 
-  // Deduplicate: skip if this is an identical packet (devices often retransmit for reliability)
-  if (service_data == this->last_service_data_) {
+  // Deduplicate: skip if this is a retransmitted packet (devices often retransmit for reliability)
+  DedupState dedup_key = make_dedup_key(service_data, len);
+  if (is_duplicate_packet(this->dedup_, dedup_key)) {
+    this->stats_.duplicates++;
     ESP_LOGV(TAG, "Skipping duplicate packet");
     return true;  // Successfully handled (by ignoring)
   }
-  this->last_service_data_ = service_data;
 
   // First byte is device_info
   uint8_t device_info = service_data[0];
@@ -692,18 +1323,20 @@ bool BTHomeDevice::parse_advertisement(const std::vector<uint8_t> &service_data)
   if (is_encrypted) {
     if (!this->encryption_enabled_) {
       ESP_LOGW(TAG, "Received encrypted data but no encryption key configured");
+      this->stats_.decrypt_failures++;
       return false;
     }
 
     // Encrypted format: device_info(1) + ciphertext + counter(4) + MIC(4)
     // The counter and MIC are at the end: [...ciphertext...][counter(4)][MIC(4)]
-    if (service_data.size() < 9) {  // device_info(1) + min_ciphertext(0) + counter(4) + MIC(4)
+    if (len < 9) {  // device_info(1) + min_ciphertext(0) + counter(4) + MIC(4)
       ESP_LOGW(TAG, "Encrypted data too short");
+      this->stats_.parse_errors++;
       return false;
     }
 
     // Extract counter from bytes [-8:-4] (4 bytes before the MIC)
-    size_t counter_offset = service_data.size() - 8;
+    size_t counter_offset = len - 8;
     uint32_t counter = service_data[counter_offset] | (service_data[counter_offset + 1] << 8) |
                        (service_data[counter_offset + 2] << 16) | (service_data[counter_offset + 3] << 24);
 
@@ -712,277 +1345,393 @@ bool BTHomeDevice::parse_advertisement(const std::vector<uint8_t> &service_data)
     // Validate counter (replay protection)
     if (counter <= this->last_counter_) {
       ESP_LOGW(TAG, "Counter not increased (replay attack?): %u <= %u", counter, this->last_counter_);
+      this->stats_.replays++;
       return false;
     }
 
-    // Ciphertext is between device_info and counter
-    const uint8_t *ciphertext = service_data.data() + 1;
-    size_t ciphertext_len = service_data.size() - 1 - 4;  // Exclude device_info and counter+MIC
-
-    // Get MAC address (6 bytes)
-    uint8_t mac[6];
-    for (int i = 0; i < 6; i++) {
-      mac[i] = (this->address_ >> (i * 8)) & 0xFF;
-    }
-
     size_t plaintext_len;
-    if (!this->decrypt_payload_(ciphertext, ciphertext_len, mac, device_info, counter, decrypted_buffer,
-                                 &plaintext_len)) {
+#ifdef USE_BTHOME_RECEIVER_METRICS
+    int64_t decrypt_start = esp_timer_get_time();
+#endif
+    bool decrypted = decrypt_bthome_payload(&this->ccm_ctx_, this->nonce_prefix_, service_data + 1, len - 1,
+                                            device_info, counter, decrypted_buffer, &plaintext_len);
+#ifdef USE_BTHOME_RECEIVER_METRICS
+    this->parent_->record_stage(STAGE_DECRYPT, esp_timer_get_time() - decrypt_start);
+#endif
+    if (!decrypted) {
       ESP_LOGW(TAG, "Decryption failed");
+      this->stats_.decrypt_failures++;
       return false;
     }
 
     // Update last counter after successful decryption
+    if (this->last_counter_ != 0) {
+      this->count_gap_(counter - this->last_counter_ - 1);
+    }
     this->last_counter_ = counter;
 
     payload_data = decrypted_buffer;
     payload_len = plaintext_len;
-    ESP_LOGV(TAG, "Decrypted %d bytes", plaintext_len);
+    ESP_LOGV(TAG, "Decrypted %zu bytes", plaintext_len);
   } else {
     // Unencrypted: just skip device_info byte
-    payload_data = service_data.data() + 1;
-    payload_len = service_data.size() - 1;
+    payload_data = service_data + 1;
+    payload_len = len - 1;
   }
 
+  // Only a packet that passed decryption and the counter check becomes the dedup reference
+  this->count_gap_(commit_packet(this->dedup_, dedup_key));
+  this->stats_.packets++;
+  this->note_packet_(esp_timer_get_time() / 1000);
+
   // Parse measurements
   this->parse_measurements_(payload_data, payload_len);
   return true;
 }
 
-bool BTHomeDevice::decrypt_payload_(const uint8_t *ciphertext, size_t ciphertext_len, const uint8_t *mac,
-                                     uint8_t device_info, uint32_t counter, uint8_t *plaintext,
-                                     size_t *plaintext_len) {
-  // BTHome v2 AES-CCM decryption
-  // Nonce: MAC(6) + UUID(2, little-endian) + device_info(1) + counter(4) = 13 bytes
-  uint8_t nonce[13];
-  memcpy(nonce, mac, 6);
-  nonce[6] = BTHOME_SERVICE_UUID & 0xFF;         // 0xD2
-  nonce[7] = (BTHOME_SERVICE_UUID >> 8) & 0xFF;  // 0xFC
-  nonce[8] = device_info;
-  nonce[9] = counter & 0xFF;
-  nonce[10] = (counter >> 8) & 0xFF;
-  nonce[11] = (counter >> 16) & 0xFF;
-  nonce[12] = (counter >> 24) & 0xFF;
-
-  // The ciphertext_len includes the MIC (4 bytes)
-  if (ciphertext_len < 4) {
-    ESP_LOGE(TAG, "Ciphertext too short for MIC");
-    return false;
-  }
-
-  size_t actual_ciphertext_len = ciphertext_len - 4;
-  const uint8_t *mic = ciphertext + actual_ciphertext_len;
-
-  // Prepare combined buffer for mbedtls (ciphertext + tag)
-  uint8_t combined[256];
-  if (ciphertext_len > sizeof(combined)) {
-    ESP_LOGE(TAG, "Ciphertext too long");
-    return false;
-  }
-  memcpy(combined, ciphertext, ciphertext_len);
-
-  mbedtls_ccm_context ctx;
-  mbedtls_ccm_init(&ctx);
+void BTHomeDevice::parse_measurements_(const uint8_t *data, size_t len) {
+#ifdef USE_BTHOME_RECEIVER_METRICS
+  // Time spent in the publish dispatch below is accounted to the publish stage, the rest to parse
+  int64_t parse_start = esp_timer_get_time();
+  int64_t publish_us = 0;
+#endif
 
-  int ret = mbedtls_ccm_setkey(&ctx, MBEDTLS_CIPHER_ID_AES, this->encryption_key_.data(), 128);
-  if (ret != 0) {
-    ESP_LOGE(TAG, "mbedtls_ccm_setkey failed: %d", ret);
-    mbedtls_ccm_free(&ctx);
-    return false;
+  // Fast path: same length and ID bytes as a learned packet, decode straight from its layout
+  if (this->layout_cache_ != nullptr) {
+    const PacketShape *shape = this->layout_cache_->match(data, len);
+    if (shape != nullptr) {
+#ifdef USE_BTHOME_RECEIVER_METRICS
+      int64_t publish_start = esp_timer_get_time();
+#endif
+      this->publish_layout_(*shape, data);
+#ifdef USE_BTHOME_RECEIVER_METRICS
+      publish_us = esp_timer_get_time() - publish_start;
+      this->parent_->record_stage(STAGE_PARSE, publish_start - parse_start);
+      this->parent_->record_stage(STAGE_PUBLISH, publish_us);
+#endif
+      return;
+    }
   }
 
-  ret = mbedtls_ccm_auth_decrypt(&ctx, actual_ciphertext_len, nonce, sizeof(nonce), nullptr, 0, ciphertext, plaintext,
-                                  mic, 4);
-  mbedtls_ccm_free(&ctx);
+  size_t pos = 0;
+  bthome_codec::DecodedObject obj;
 
-  if (ret != 0) {
-    ESP_LOGE(TAG, "mbedtls_ccm_auth_decrypt failed: %d", ret);
-    return false;
+  // Track how many times we've seen each object_id (for indexed sensors like speed/gusts)
+  ObjectOccurrences occurrences;
+
+  // Learn the layout of this packet while decoding it. Only packets made of fixed-size sensor
+  // and binary sensor objects are learned; events and text/raw data always take this path.
+  PacketShape shape;
+  bool learn = this->layout_cache_ != nullptr;
+  if (learn) {
+    shape.payload_len = len;
   }
 
-  *plaintext_len = actual_ciphertext_len;
-  return true;
-}
-
-void BTHomeDevice::parse_measurements_(const uint8_t *data, size_t len) {
-  size_t pos = 0;
+  while (true) {
+    size_t object_pos = pos;
+    bthome_codec::DecodeStatus status = bthome_codec::next_object(data, len, pos, obj);
+    if (status == bthome_codec::DECODE_END)
+      break;
 
-  // Track how many times we've seen each object_id (for indexed sensors like speed/gusts)
-  // Using std::array instead of std::map for better embedded performance (no dynamic allocation)
-  std::array<uint8_t, 256> object_id_counts{};  // Zero-initialized
+    if (status == bthome_codec::DECODE_UNKNOWN_OBJECT) {
+      // Dump entire packet for debugging unknown object IDs
+      std::string hex_dump;
+      for (size_t i = 0; i < len; i++) {
+        char hex[4];
+        snprintf(hex, sizeof(hex), "%02X ", data[i]);
+        hex_dump += hex;
+      }
+      ESP_LOGW(TAG, "Unknown object ID: 0x%02X at pos %zu, full packet: %s", obj.object_id, pos - 1, hex_dump.c_str());
+      this->stats_.parse_errors++;
+      learn = false;
+      // Skip this measurement - we don't know its size, so we have to stop parsing
+      break;
+    }
 
-  while (pos < len) {
-    if (pos + 1 > len) {
-      ESP_LOGW(TAG, "Incomplete measurement at offset %d", pos);
+    if (status == bthome_codec::DECODE_TRUNCATED) {
+      ESP_LOGW(TAG, "Incomplete data for object 0x%02X at offset %zu", obj.object_id, pos - 1);
+      this->stats_.parse_errors++;
+      learn = false;
       break;
     }
 
-    uint8_t object_id = data[pos++];
-    ESP_LOGV(TAG, "Object ID: 0x%02X at offset %d", object_id, pos - 1);
+    uint8_t object_id = obj.object_id;
+    ESP_LOGV(TAG, "Object ID: 0x%02X", object_id);
 
     // Get current index for this object_id (0 for first occurrence, 1 for second, etc.)
-    uint8_t current_index = object_id_counts[object_id]++;  // Post-increment
-
-    // Handle special types: button, dimmer, text, raw
-    if (object_id == OBJECT_ID_BUTTON) {
-      // Button event: object_id(1) + event_type(1)
-      if (pos + 1 > len) {
-        ESP_LOGW(TAG, "Incomplete button event");
-        break;
-      }
-      uint8_t event_data = data[pos++];
-      uint8_t button_index = (event_data >> 4) & 0x0F;  // Upper 4 bits
-      uint8_t event_type = event_data & 0x0F;           // Lower 4 bits
-      ESP_LOGV(TAG, "Button event: index=%d, type=0x%02X", button_index, event_type);
-      this->handle_button_event_(button_index, event_type);
-      continue;
+    uint8_t current_index = occurrences.next(object_id);
+    if (occurrences.overflowed()) {
+      learn = false;  // The index may be wrong, don't cache it
     }
 
-    if (object_id == OBJECT_ID_DIMMER) {
-      // Dimmer event: object_id(1) + steps(1, signed)
-      if (pos + 1 > len) {
-        ESP_LOGW(TAG, "Incomplete dimmer event");
-        break;
-      }
-      int8_t steps = static_cast<int8_t>(data[pos++]);
-      ESP_LOGV(TAG, "Dimmer event: steps=%d", steps);
-      this->handle_dimmer_event_(steps);
-      continue;
+    if (learn) {
+      learn = this->learn_object_(shape, object_pos, obj, current_index, data);
     }
 
-    if (object_id == OBJECT_ID_TEXT) {
-      // Text: object_id(1) + length(1) + UTF-8 string
-      if (pos + 1 > len) {
-        ESP_LOGW(TAG, "Incomplete text length");
+#ifdef USE_BTHOME_RECEIVER_METRICS
+    int64_t publish_start = esp_timer_get_time();
+#endif
+    switch (obj.info->kind) {
+      case bthome_codec::OBJECT_KIND_EVENT:
+        if (object_id == bthome_codec::OBJECT_ID_BUTTON) {
+          // Button event: upper 4 bits = button index, lower 4 bits = event type
+          uint8_t button_index = (obj.payload[0] >> 4) & 0x0F;
+          uint8_t event_type = obj.payload[0] & 0x0F;
+          ESP_LOGV(TAG, "Button event: index=%d, type=0x%02X", button_index, event_type);
+          this->handle_button_event_(button_index, event_type);
+        } else {
+          // Dimmer event: signed steps
+          int8_t steps = static_cast<int8_t>(obj.payload[0]);
+          ESP_LOGV(TAG, "Dimmer event: steps=%d", steps);
+          this->handle_dimmer_event_(steps);
+        }
         break;
-      }
-      uint8_t text_len = data[pos++];
-      if (pos + text_len > len) {
-        ESP_LOGW(TAG, "Incomplete text data");
+
+      case bthome_codec::OBJECT_KIND_VARIABLE:
+        if (object_id == bthome_codec::OBJECT_ID_TEXT) {
+          // Text: UTF-8 string
+          std::string text(reinterpret_cast<const char *>(obj.payload), obj.payload_len);
+          ESP_LOGV(TAG, "Text: '%s'", text.c_str());
+          this->publish_text_value_(object_id, text);
+        } else {
+          // Raw: display as hex
+          std::string hex_str;
+          for (uint8_t i = 0; i < obj.payload_len; i++) {
+            char hex[3];
+            snprintf(hex, sizeof(hex), "%02X", obj.payload[i]);
+            if (i > 0)
+              hex_str += " ";
+            hex_str += hex;
+          }
+          ESP_LOGV(TAG, "Raw: %s", hex_str.c_str());
+          this->publish_text_value_(object_id, hex_str);
+        }
         break;
-      }
-      std::string text(reinterpret_cast<const char *>(data + pos), text_len);
-      pos += text_len;
-      ESP_LOGV(TAG, "Text: '%s'", text.c_str());
-      this->publish_text_value_(object_id, text);
-      continue;
-    }
 
-    if (object_id == OBJECT_ID_RAW) {
-      // Raw: object_id(1) + length(1) + raw bytes (display as hex)
-      if (pos + 1 > len) {
-        ESP_LOGW(TAG, "Incomplete raw length");
+      case bthome_codec::OBJECT_KIND_BINARY_SENSOR: {
+        // Binary sensor: single byte, 0x00 or 0x01
+        bool value = obj.payload[0] != 0;
+        ESP_LOGV(TAG, "Binary sensor 0x%02X: %s", object_id, value ? "ON" : "OFF");
+        this->publish_binary_sensor_value_(object_id, value);
         break;
       }
-      uint8_t raw_len = data[pos++];
-      if (pos + raw_len > len) {
-        ESP_LOGW(TAG, "Incomplete raw data");
+
+      default: {
+        // Numeric sensor. Factor is applied on publish, after change suppression on the raw value
+        int64_t raw_value = bthome_codec::decode_raw(obj);
+        ESP_LOGV(TAG, "Sensor 0x%02X[%d]: raw=%lld", object_id, current_index, static_cast<long long>(raw_value));
+        this->publish_sensor_value_(object_id, current_index, raw_value, obj.info->factor);
         break;
       }
-      // Convert to hex string
-      std::string hex_str;
-      for (uint8_t i = 0; i < raw_len; i++) {
-        char hex[3];
-        snprintf(hex, sizeof(hex), "%02X", data[pos + i]);
-        if (i > 0)
-          hex_str += " ";
-        hex_str += hex;
-      }
-      pos += raw_len;
-      ESP_LOGV(TAG, "Raw: %s", hex_str.c_str());
-      this->publish_text_value_(object_id, hex_str);
-      continue;
     }
+#ifdef USE_BTHOME_RECEIVER_METRICS
+    publish_us += esp_timer_get_time() - publish_start;
+#endif
+  }
 
-    // Look up standard object type
-    auto it = OBJECT_TYPE_MAP.find(object_id);
-    if (it == OBJECT_TYPE_MAP.end()) {
-      // Dump entire packet for debugging unknown object IDs
-      std::string hex_dump;
-      for (size_t i = 0; i < len; i++) {
-        char hex[4];
-        snprintf(hex, sizeof(hex), "%02X ", data[i]);
-        hex_dump += hex;
-      }
-      ESP_LOGW(TAG, "Unknown object ID: 0x%02X at pos %d, full packet: %s", object_id, pos - 1, hex_dump.c_str());
-      // Skip this measurement - we don't know its size, so we have to stop parsing
-      break;
+  if (learn && shape.object_count > 0) {
+    this->layout_cache_->store(shape);
+    ESP_LOGV(TAG, "%012llX: learned packet layout, %u objects, %u published",
+             static_cast<unsigned long long>(this->address_), shape.object_count,
+             shape.entry_count);
+  }
+
+#ifdef USE_BTHOME_RECEIVER_METRICS
+  this->parent_->record_stage(STAGE_PARSE, esp_timer_get_time() - parse_start - publish_us);
+  this->parent_->record_stage(STAGE_PUBLISH, publish_us);
+#endif
+}
+
+bool BTHomeDevice::learn_object_(PacketShape &shape, size_t object_pos, const bthome_codec::DecodedObject &obj,
+                                 uint8_t index, const uint8_t *data) {
+  bthome_codec::ObjectKind kind = obj.info->kind;
+  if ((kind != bthome_codec::OBJECT_KIND_SENSOR && kind != bthome_codec::OBJECT_KIND_BINARY_SENSOR) ||
+      shape.object_count >= MAX_PACKET_OBJECTS) {
+    return false;
+  }
+  shape.id_offsets[shape.object_count] = object_pos;
+  shape.ids[shape.object_count++] = obj.object_id;
+
+  // Objects without an entity (packet_id, unconfigured values) are only part of the shape check
+  LayoutEntry entry{};
+  entry.offset = obj.payload - data;
+  entry.object_id = obj.object_id;
+  entry.index = index;
+  entry.info = obj.info;
+  if (!this->has_dispatch_(obj.object_id)) {
+    return true;
+  }
+  if (kind == bthome_codec::OBJECT_KIND_SENSOR) {
+#ifdef USE_SENSOR
+    entry.sensor = this->sensors_.find((static_cast<uint16_t>(obj.object_id) << 8) | index);
+    if (entry.sensor == nullptr) {
+      return true;
+    }
+#else
+    return true;
+#endif
+  } else {
+#ifdef USE_BINARY_SENSOR
+    entry.binary_sensor = this->binary_sensors_.find(obj.object_id);
+    if (entry.binary_sensor == nullptr) {
+      return true;
     }
+#else
+    return true;
+#endif
+  }
+  shape.entries[shape.entry_count++] = entry;
+  return true;
+}
 
-    const ObjectTypeInfo &type_info = it->second;
+void BTHomeDevice::publish_layout_(const PacketShape &shape, const uint8_t *data) {
+  uint32_t now = esp_timer_get_time() / 1000;
+  for (uint8_t i = 0; i < shape.entry_count; i++) {
+    const LayoutEntry &entry = shape.entries[i];
+    const uint8_t *value = data + entry.offset;
+    if (entry.info->kind == bthome_codec::OBJECT_KIND_BINARY_SENSOR) {
+#ifdef USE_BINARY_SENSOR
+      entry.binary_sensor->get_sensor()->publish_state(value[0] != 0);
+      this->parent_->note_publish();
+#endif
+      continue;
+    }
+#ifdef USE_SENSOR
+    int64_t raw_value = bthome_codec::read_le(value, entry.info->data_bytes, entry.info->is_signed);
+    if (!entry.sensor->should_publish(raw_value, now)) {
+      ESP_LOGV(TAG, "Sensor 0x%02X[%d] unchanged, not publishing", entry.object_id, entry.index);
+      continue;
+    }
+    entry.sensor->get_sensor()->publish_state(raw_value * entry.info->factor);
+    this->parent_->note_publish();
+#endif
+  }
+}
 
-    // Check if we have enough data
-    if (pos + type_info.data_bytes > len) {
-      ESP_LOGW(TAG, "Incomplete data for object 0x%02X (need %d bytes, have %d)", object_id, type_info.data_bytes,
-               len - pos);
-      break;
+// ============================================================================
+// PacketLayoutCache Implementation
+// ============================================================================
+
+const PacketShape *PacketLayoutCache::match(const uint8_t *data, size_t len) {
+  for (const auto &shape : this->shapes_) {
+    if (shape.payload_len == 0 || shape.payload_len != len) {
+      continue;
+    }
+    uint8_t i = 0;
+    while (i < shape.object_count && data[shape.id_offsets[i]] == shape.ids[i]) {
+      i++;
     }
+    if (i == shape.object_count) {
+      this->hits_++;
+      return &shape;
+    }
+  }
+  return nullptr;
+}
 
-    // Decode value based on type
-    if (type_info.is_binary_sensor) {
-      // Binary sensor: single byte, 0x00 or 0x01
-      bool value = data[pos] != 0;
-      pos += type_info.data_bytes;
-      ESP_LOGV(TAG, "Binary sensor 0x%02X: %s", object_id, value ? "ON" : "OFF");
-      this->publish_binary_sensor_value_(object_id, value);
-    } else if (type_info.is_sensor) {
-      // Numeric sensor: decode based on data_bytes and signedness
-      int32_t raw_value = 0;
-
-      if (type_info.is_signed) {
-        // Signed integer (little-endian)
-        switch (type_info.data_bytes) {
-          case 1:
-            raw_value = static_cast<int8_t>(data[pos]);
-            break;
-          case 2:
-            raw_value = static_cast<int16_t>(data[pos] | (data[pos + 1] << 8));
-            break;
-          case 3:
-            // sint24: sign-extend from 24 bits to 32 bits
-            raw_value = data[pos] | (data[pos + 1] << 8) | (data[pos + 2] << 16);
-            if (raw_value & 0x800000)
-              raw_value |= 0xFF000000;  // Sign extend
-            break;
-          case 4:
-            raw_value = data[pos] | (data[pos + 1] << 8) | (data[pos + 2] << 16) | (data[pos + 3] << 24);
-            break;
-        }
-      } else {
-        // Unsigned integer (little-endian)
-        uint32_t unsigned_value = 0;
-        switch (type_info.data_bytes) {
-          case 1:
-            unsigned_value = data[pos];
-            break;
-          case 2:
-            unsigned_value = data[pos] | (data[pos + 1] << 8);
-            break;
-          case 3:
-            unsigned_value = data[pos] | (data[pos + 1] << 8) | (data[pos + 2] << 16);
-            break;
-          case 4:
-            unsigned_value = data[pos] | (data[pos + 1] << 8) | (data[pos + 2] << 16) | (data[pos + 3] << 24);
-            break;
-        }
-        raw_value = unsigned_value;
-      }
+void PacketLayoutCache::store(const PacketShape &shape) {
+  this->shapes_[this->next_slot_] = shape;
+  this->next_slot_ = (this->next_slot_ + 1) % LAYOUT_SHAPES;
+  this->learned_++;
+}
 
-      pos += type_info.data_bytes;
+void PacketLayoutCache::clear() {
+  for (auto &shape : this->shapes_) {
+    shape.payload_len = 0;
+  }
+}
 
-      // Apply factor to convert to actual value
-      float value = raw_value * type_info.factor;
-      ESP_LOGV(TAG, "Sensor 0x%02X[%d]: raw=%d, value=%.3f", object_id, current_index, raw_value, value);
-      this->publish_sensor_value_(object_id, current_index, value);
+#ifdef USE_SENSOR
+bool BTHomeSensor::should_publish(int64_t raw_value, uint32_t now) {
+  if (this->deadband_ >= 0 && this->has_published_) {
+    int64_t delta = raw_value - this->last_raw_value_;
+    if (delta < 0)
+      delta = -delta;
+    bool changed = delta > this->deadband_;
+    bool heartbeat_due = this->heartbeat_ > 0 && (now - this->last_publish_) >= this->heartbeat_;
+    if (!changed && !heartbeat_due) {
+      return false;
     }
   }
+  this->has_published_ = true;
+  this->last_raw_value_ = raw_value;
+  this->last_publish_ = now;
+  return true;
+}
+
+void BTHomeDevice::add_sensor(uint8_t object_id, uint8_t index, sensor::Sensor *sensor, int32_t deadband,
+                              uint32_t heartbeat) {
+  BTHomeSensor sensor_obj(object_id, index, sensor);
+  sensor_obj.set_deadband(deadband);
+  sensor_obj.set_heartbeat(heartbeat);
+  if (!this->sensors_.insert(sensor_obj)) {
+    ESP_LOGE(TAG, "Sensor storage full (%u entries), sensor 0x%02X[%u] not registered", this->sensors_.capacity(),
+             object_id, index);
+    return;
+  }
+  this->set_dispatch_bit_(object_id);
+  if (this->layout_cache_ != nullptr) {
+    this->layout_cache_->clear();  // Entries point into the table that just shifted
+  }
+}
+#endif
+
+#ifdef USE_BINARY_SENSOR
+void BTHomeDevice::add_binary_sensor(uint8_t object_id, binary_sensor::BinarySensor *sensor) {
+  if (!this->binary_sensors_.insert(BTHomeBinarySensor(object_id, sensor))) {
+    ESP_LOGE(TAG, "Binary sensor storage full (%u entries), object 0x%02X not registered",
+             this->binary_sensors_.capacity(), object_id);
+    return;
+  }
+  this->set_dispatch_bit_(object_id);
+  if (this->layout_cache_ != nullptr) {
+    this->layout_cache_->clear();  // Entries point into the table that just shifted
+  }
+}
+#endif
+
+#ifdef USE_TEXT_SENSOR
+void BTHomeDevice::add_text_sensor(uint8_t object_id, text_sensor::TextSensor *sensor) {
+  if (!this->text_sensors_.insert(BTHomeTextSensor(object_id, sensor))) {
+    ESP_LOGE(TAG, "Text sensor storage full (%u entries), object 0x%02X not registered",
+             this->text_sensors_.capacity(), object_id);
+    return;
+  }
+  this->set_dispatch_bit_(object_id);
+}
+#endif
+
+void BTHomeDevice::add_button_trigger(BTHomeButtonTrigger *trigger) {
+  auto it = std::upper_bound(this->button_triggers_.begin(), this->button_triggers_.end(), trigger->get_key(),
+                             [](uint16_t key, const BTHomeButtonTrigger *t) { return key < t->get_key(); });
+  this->button_triggers_.insert(it, trigger);
+  this->set_dispatch_bit_(bthome_codec::OBJECT_ID_BUTTON);
+}
+
+void BTHomeDevice::add_dimmer_trigger(BTHomeDimmerTrigger *trigger) {
+  this->dimmer_triggers_.push_back(trigger);
+  this->set_dispatch_bit_(bthome_codec::OBJECT_ID_DIMMER);
 }
 
-void BTHomeDevice::publish_sensor_value_(uint8_t object_id, uint8_t index, float value) {
+void BTHomeDevice::publish_sensor_value_(uint8_t object_id, uint8_t index, int64_t raw_value, float factor) {
+  if (this->auto_provisioned_) {
+    if (object_id != bthome_codec::OBJECT_ID_PACKET_ID) {
+      this->parent_->fan_out_measurement(this->address_, object_id, index, raw_value * factor);
+    }
+    return;
+  }
 #ifdef USE_SENSOR
-  for (auto *sensor_obj : this->sensors_) {
-    if (sensor_obj->get_object_id() == object_id && sensor_obj->get_index() == index) {
-      sensor_obj->get_sensor()->publish_state(value);
+  if (this->has_dispatch_(object_id)) {
+    uint16_t key = (static_cast<uint16_t>(object_id) << 8) | index;
+    BTHomeSensor *sensor_obj = this->sensors_.find(key);
+    if (sensor_obj != nullptr) {
+      uint32_t now = esp_timer_get_time() / 1000;
+      if (!sensor_obj->should_publish(raw_value, now)) {
+        ESP_LOGV(TAG, "Sensor 0x%02X[%d] unchanged, not publishing", object_id, index);
+        return;
+      }
+      sensor_obj->get_sensor()->publish_state(raw_value * factor);
+      this->parent_->note_publish();
       return;
     }
   }
@@ -991,10 +1740,16 @@ void BTHomeDevice::publish_sensor_value_(uint8_t object_id, uint8_t index, float
 }
 
 void BTHomeDevice::publish_binary_sensor_value_(uint8_t object_id, bool value) {
+  if (this->auto_provisioned_) {
+    this->parent_->fan_out_measurement(this->address_, object_id, 0, value ? 1.0f : 0.0f);
+    return;
+  }
 #ifdef USE_BINARY_SENSOR
-  for (auto *sensor_obj : this->binary_sensors_) {
-    if (sensor_obj->get_object_id() == object_id) {
+  if (this->has_dispatch_(object_id)) {
+    BTHomeBinarySensor *sensor_obj = this->binary_sensors_.find(object_id);
+    if (sensor_obj != nullptr) {
       sensor_obj->get_sensor()->publish_state(value);
+      this->parent_->note_publish();
       return;
     }
   }
@@ -1004,10 +1759,14 @@ void BTHomeDevice::publish_binary_sensor_value_(uint8_t object_id, bool value) {
 
 void BTHomeDevice::publish_text_value_(uint8_t object_id, const std::string &value) {
 #ifdef USE_TEXT_SENSOR
-  for (auto *sensor_obj : this->text_sensors_) {
-    if (sensor_obj->get_object_id() == object_id) {
-      sensor_obj->get_sensor()->publish_state(value);
-      return;
+  // At most two entries (text and raw), a scan is as fast as anything else
+  if (this->has_dispatch_(object_id)) {
+    for (auto &sensor_obj : this->text_sensors_) {
+      if (sensor_obj.get_object_id() == object_id) {
+        sensor_obj.get_sensor()->publish_state(value);
+        this->parent_->note_publish();
+        return;
+      }
     }
   }
 #endif
@@ -1015,10 +1774,11 @@ void BTHomeDevice::publish_text_value_(uint8_t object_id, const std::string &val
 }
 
 void BTHomeDevice::handle_button_event_(uint8_t button_index, uint8_t event_type) {
-  for (auto *trigger : this->button_triggers_) {
-    if (trigger->get_button_index() == button_index && trigger->get_event_type() == event_type) {
-      trigger->trigger();
-    }
+  uint16_t key = (static_cast<uint16_t>(button_index) << 8) | event_type;
+  auto it = std::lower_bound(this->button_triggers_.begin(), this->button_triggers_.end(), key,
+                             [](const BTHomeButtonTrigger *t, uint16_t key) { return t->get_key() < key; });
+  for (; it != this->button_triggers_.end() && (*it)->get_key() == key; ++it) {
+    (*it)->trigger();
   }
 }
 
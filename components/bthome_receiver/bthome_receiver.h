@@ -3,19 +3,20 @@
 #include "esphome/core/component.h"
 #include "esphome/core/helpers.h"
 #include "esphome/core/automation.h"
+#include "esphome/components/bthome_codec/bthome_codec.h"
 
 // ESP-IDF timer for time tracking
 #include <esp_timer.h>
 
+// AES-CCM for decrypting encrypted BTHome payloads
+#include "mbedtls/ccm.h"
+
 // Platform-specific includes based on BLE stack
 #ifdef USE_BTHOME_RECEIVER_NIMBLE
-  // NimBLE stack (lighter weight, observer-only)
-  #include "nimble/nimble_port.h"
-  #include "nimble/nimble_port_freertos.h"
+  // NimBLE stack (lighter weight), host shared with the bthome broadcaster
+  #include "esphome/components/bthome_nimble/nimble_host.h"
   #include "host/ble_hs.h"
   #include "host/util/util.h"
-  #include <freertos/FreeRTOS.h>
-  #include <freertos/semphr.h>
 #elif defined(USE_BTHOME_RECEIVER_BLUEDROID)
   // Bluedroid stack (default, via esp32_ble_tracker)
   #include "esphome/components/esp32_ble_tracker/esp32_ble_tracker.h"
@@ -32,24 +33,17 @@
 #endif
 
 #include <vector>
-#include <map>
 #include <array>
+#include <atomic>
+#include <algorithm>
+#include <cmath>
 
 namespace esphome {
 namespace bthome_receiver {
 
-// BTHome v2 constants
-static const uint16_t BTHOME_SERVICE_UUID = 0xFCD2;
-
 // Device info byte format: bit 0 = encryption, bit 2 = trigger-based
 static const uint8_t BTHOME_DEVICE_INFO_ENCRYPTED_MASK = 0x01;
 
-// Special object IDs for events and variable-length data
-static const uint8_t OBJECT_ID_BUTTON = 0x3A;
-static const uint8_t OBJECT_ID_DIMMER = 0x3C;
-static const uint8_t OBJECT_ID_TEXT = 0x53;
-static const uint8_t OBJECT_ID_RAW = 0x54;
-
 // Button event types (BTHome v2 spec object ID 0x3A)
 static const uint8_t BUTTON_EVENT_NONE = 0x00;
 static const uint8_t BUTTON_EVENT_PRESS = 0x01;
@@ -63,16 +57,226 @@ static const uint8_t BUTTON_EVENT_HOLD_PRESS = 0x80;
 // Encryption constants
 static const size_t AES_KEY_SIZE = 16;
 
-// Object type info for parsing BTHome data
-struct ObjectTypeInfo {
-  uint8_t data_bytes;
-  bool is_signed;
-  float factor;
-  bool is_sensor;
-  bool is_binary_sensor;
+// Service data can never exceed a legacy advertisement (31 bytes incl. AD headers)
+static const size_t MAX_SERVICE_DATA_SIZE = 31;
+static const size_t MAX_ADV_DATA_SIZE = 31;
+
+// Default number of devices kept by the discovery cache (dump_interval mode)
+static const uint16_t DEFAULT_DISCOVERY_CACHE_SIZE = 32;
+
+// Adaptive scan scheduling (NimBLE): duty levels and the scan parameters used for each.
+// Interval and window are in 0.625 ms units.
+enum ScanDuty : uint8_t {
+  SCAN_DUTY_LOW = 0,  // Nothing expected soon: 10% duty
+  SCAN_DUTY_NORMAL,   // Learning device intervals or discovering: 50% duty
+  SCAN_DUTY_HIGH,     // A registered device is due or traffic is bursty: 100% duty
+  SCAN_DUTY_COUNT,
+};
+static const uint16_t SCAN_INTERVAL = 160;  // 100 ms
+static const uint16_t SCAN_WINDOWS[SCAN_DUTY_COUNT] = {16, 80, 160};
+// Window cap while the bthome broadcaster shares the radio, leaving room for its advertising events
+static const uint16_t SCAN_WINDOW_SHARED = 144;  // 90%
+static const uint32_t SCAN_SCHEDULE_PERIOD_MS = 250;  // How often the duty is re-evaluated
+static const uint32_t SCAN_BURST_THRESHOLD = 16;      // Reports per period that count as bursty
+static const uint32_t SCAN_DUE_MARGIN_MS = 500;       // Minimum lead time before a device is due
+static const uint32_t SCAN_ABSENT_FACTOR = 4;         // Missed intervals before a device is re-learned
+
+// Per-device statistics sensors are published at this interval
+static const uint32_t STATS_PUBLISH_INTERVAL_MS = 60000;
+// packet_id / counter jumps larger than this are treated as a device restart, not packet loss
+static const uint32_t MAX_COUNTED_PACKET_GAP = 64;
+
+// Max cached devices logged per loop() iteration by the periodic dump
+static const size_t DUMP_DEVICES_PER_LOOP = 4;
+
+// Advertisement queue between the BLE host task and loop()
+static const size_t ADV_QUEUE_SIZE = 64;          // Must be a power of two
+static const size_t ADV_QUEUE_LOOP_BUDGET = 32;   // Max advertisements processed per loop() iteration
+
+// NimBLE bring-up: give up if the host has not synced with the controller within this time
+static const uint32_t NIMBLE_SYNC_TIMEOUT_MS = 5000;
+
+// Pipeline metrics: default summary interval and latency histogram bucket upper bounds (microseconds).
+// Samples at or above the last bound land in an overflow bucket.
+static const uint32_t DEFAULT_METRICS_INTERVAL_MS = 60000;
+static const uint32_t LATENCY_BUCKET_LIMITS_US[] = {10, 25, 50, 100, 250, 500, 1000, 2500, 5000, 10000};
+static const size_t LATENCY_BUCKET_COUNT = sizeof(LATENCY_BUCKET_LIMITS_US) / sizeof(LATENCY_BUCKET_LIMITS_US[0]) + 1;
+
+// =============================================================================
+// RawAdvertisement - BTHome service data of a scan report, copied out of the BLE stack's buffer.
+// Reports without BTHome service data are rejected before they are queued.
+// =============================================================================
+struct RawAdvertisement {
+  uint8_t address[6];  // Little-endian, as delivered by the controller
+  int8_t rssi;
+  uint8_t data_len;
+  uint8_t data[MAX_SERVICE_DATA_SIZE];  // Service data after the UUID
+#ifdef USE_BTHOME_RECEIVER_METRICS
+  uint32_t queued_at;    // esp_timer_get_time() at commit_push(), truncated to 32 bits
+  uint16_t callback_us;  // Time spent in the GAP callback for this report
+#endif
+};
+
+// =============================================================================
+// SPSCQueue - Fixed-capacity lock-free single-producer/single-consumer ring
+// The producer (BLE host task) fills slots in place via prepare_push()/commit_push(),
+// the consumer (loop()) reads them in place via front()/pop(). Neither side blocks.
+// =============================================================================
+template<typename T, size_t N> class SPSCQueue {
+  static_assert(N > 0 && (N & (N - 1)) == 0, "SPSCQueue size must be a power of two");
+
+ public:
+  // Producer: get the next free slot, or nullptr (counted as a drop) when the queue is full
+  T *prepare_push() {
+    uint32_t head = this->head_.load(std::memory_order_relaxed);
+    if (head - this->tail_.load(std::memory_order_acquire) >= N) {
+      this->drops_.fetch_add(1, std::memory_order_relaxed);
+      return nullptr;
+    }
+    return &this->buffer_[head & (N - 1)];
+  }
+
+  // Producer: publish the slot returned by prepare_push()
+  void commit_push() {
+    uint32_t head = this->head_.load(std::memory_order_relaxed) + 1;
+    this->head_.store(head, std::memory_order_release);
+    uint32_t depth = head - this->tail_.load(std::memory_order_relaxed);
+    if (depth > this->high_water_.load(std::memory_order_relaxed)) {
+      this->high_water_.store(depth, std::memory_order_relaxed);
+    }
+  }
+
+  // Consumer: oldest queued element, or nullptr when empty
+  const T *front() const {
+    uint32_t tail = this->tail_.load(std::memory_order_relaxed);
+    if (tail == this->head_.load(std::memory_order_acquire)) {
+      return nullptr;
+    }
+    return &this->buffer_[tail & (N - 1)];
+  }
+
+  // Consumer: release the element returned by front()
+  void pop() { this->tail_.store(this->tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+  size_t capacity() const { return N; }
+  uint32_t get_drops() const { return this->drops_.load(std::memory_order_relaxed); }
+  uint32_t get_high_water() const { return this->high_water_.load(std::memory_order_relaxed); }
+
+ protected:
+  T buffer_[N];
+  std::atomic<uint32_t> head_{0};  // Written by producer only
+  std::atomic<uint32_t> tail_{0};  // Written by consumer only
+  std::atomic<uint32_t> drops_{0};
+  std::atomic<uint32_t> high_water_{0};
 };
 
 // Forward declarations
+#ifdef USE_BTHOME_RECEIVER_METRICS
+// =============================================================================
+// LatencyHistogram - Fixed-bucket latency histogram, no allocation and O(buckets) per sample.
+// Only written and read from loop(), so it needs no synchronization.
+// =============================================================================
+class LatencyHistogram {
+ public:
+  static size_t bucket_for(uint32_t us) {
+    size_t bucket = 0;
+    while (bucket < LATENCY_BUCKET_COUNT - 1 && us >= LATENCY_BUCKET_LIMITS_US[bucket]) {
+      bucket++;
+    }
+    return bucket;
+  }
+
+  void record(uint32_t us) {
+    this->buckets_[bucket_for(us)]++;
+    this->count_++;
+    this->total_us_ += us;
+    if (us > this->max_us_) {
+      this->max_us_ = us;
+    }
+  }
+
+  // Add samples collected elsewhere, see AtomicLatencyHistogram::drain_into()
+  void merge(const uint32_t *buckets, uint64_t total_us, uint32_t max_us) {
+    for (size_t i = 0; i < LATENCY_BUCKET_COUNT; i++) {
+      this->buckets_[i] += buckets[i];
+      this->count_ += buckets[i];
+    }
+    this->total_us_ += total_us;
+    if (max_us > this->max_us_) {
+      this->max_us_ = max_us;
+    }
+  }
+
+  uint32_t get_count() const { return this->count_; }
+  uint32_t get_max() const { return this->max_us_; }
+  float get_mean() const { return this->count_ > 0 ? static_cast<float>(this->total_us_) / this->count_ : NAN; }
+
+  // Upper bound of the bucket holding the given percentile (the max for the overflow bucket)
+  uint32_t get_percentile(uint8_t percent) const {
+    uint32_t target = (static_cast<uint64_t>(this->count_) * percent + 99) / 100;
+    uint32_t seen = 0;
+    for (size_t i = 0; i < LATENCY_BUCKET_COUNT - 1; i++) {
+      seen += this->buckets_[i];
+      if (seen >= target) {
+        return std::min(LATENCY_BUCKET_LIMITS_US[i], this->max_us_);
+      }
+    }
+    return this->max_us_;
+  }
+
+  void reset() { *this = LatencyHistogram(); }
+
+ protected:
+  uint32_t buckets_[LATENCY_BUCKET_COUNT]{};
+  uint32_t count_{0};
+  uint64_t total_us_{0};
+  uint32_t max_us_{0};
+};
+
+// =============================================================================
+// AtomicLatencyHistogram - LatencyHistogram samples recorded by a single producer on another task
+// (the NimBLE host task) and periodically moved into a LatencyHistogram by loop().
+// =============================================================================
+class AtomicLatencyHistogram {
+ public:
+  void record(uint32_t us) {
+    this->buckets_[LatencyHistogram::bucket_for(us)].fetch_add(1, std::memory_order_relaxed);
+    this->total_us_.fetch_add(us, std::memory_order_relaxed);
+    if (us > this->max_us_.load(std::memory_order_relaxed)) {
+      this->max_us_.store(us, std::memory_order_relaxed);
+    }
+  }
+
+  void drain_into(LatencyHistogram &histogram) {
+    uint32_t buckets[LATENCY_BUCKET_COUNT];
+    for (size_t i = 0; i < LATENCY_BUCKET_COUNT; i++) {
+      buckets[i] = this->buckets_[i].exchange(0, std::memory_order_relaxed);
+    }
+    histogram.merge(buckets, this->total_us_.exchange(0, std::memory_order_relaxed),
+                    this->max_us_.exchange(0, std::memory_order_relaxed));
+  }
+
+ protected:
+  std::atomic<uint32_t> buckets_[LATENCY_BUCKET_COUNT]{};
+  std::atomic<uint32_t> total_us_{0};  // Drained every metrics interval, long before it can wrap
+  std::atomic<uint32_t> max_us_{0};
+};
+
+// Receive pipeline stages, in the order an advertisement passes through them
+enum PipelineStage : uint8_t {
+  STAGE_CALLBACK = 0,  // Radio callback for BTHome reports (NimBLE GAP callback / Bluedroid listener)
+  STAGE_PREFILTER,     // Radio callback for reports the prefilter rejected (not BTHome)
+  STAGE_QUEUE,         // Waiting in the advertisement queue (NimBLE only)
+  STAGE_LOOKUP,        // Discovery cache + registered device lookup
+  STAGE_DECRYPT,       // AES-CCM decryption
+  STAGE_PARSE,         // Object decoding, excluding publish
+  STAGE_PUBLISH,       // Sensor/trigger callbacks
+  STAGE_COUNT,
+};
+static const char *const PIPELINE_STAGE_NAMES[STAGE_COUNT] = {"callback", "prefilter", "queue",  "lookup",
+                                                              "decrypt",  "parse",     "publish"};
+#endif
+
 class BTHomeReceiverHub;
 class BTHomeDevice;
 
@@ -83,17 +287,33 @@ class BTHomeDevice;
 #ifdef USE_SENSOR
 class BTHomeSensor {
  public:
+  BTHomeSensor() = default;
   BTHomeSensor(uint8_t object_id, uint8_t index, sensor::Sensor *sensor)
       : object_id_(object_id), index_(index), sensor_(sensor) {}
 
+  // Publish suppression: only publish when the raw value moved by more than deadband counts
+  // since the last publish, or heartbeat ms have passed. deadband < 0 disables suppression.
+  void set_deadband(int32_t deadband) { this->deadband_ = deadband; }
+  void set_heartbeat(uint32_t heartbeat) { this->heartbeat_ = heartbeat; }
+
+  // Returns true if a value with this raw reading should be published now (and records it)
+  bool should_publish(int64_t raw_value, uint32_t now);
+
   uint8_t get_object_id() const { return this->object_id_; }
   uint8_t get_index() const { return this->index_; }
+  // Dispatch key: sensors are kept sorted by (object_id, index)
+  uint16_t get_key() const { return (static_cast<uint16_t>(this->object_id_) << 8) | this->index_; }
   sensor::Sensor *get_sensor() { return this->sensor_; }
 
  protected:
-  uint8_t object_id_;
-  uint8_t index_;  // For multiple sensors of same type (0=first, 1=second, etc.)
-  sensor::Sensor *sensor_;
+  uint8_t object_id_{0};
+  uint8_t index_{0};  // For multiple sensors of same type (0=first, 1=second, etc.)
+  bool has_published_{false};
+  sensor::Sensor *sensor_{nullptr};
+  int32_t deadband_{-1};       // In raw (pre-factor) counts, -1 = publish every value
+  uint32_t heartbeat_{0};      // ms, 0 = no heartbeat
+  int64_t last_raw_value_{0};  // Raw value of the last publish
+  uint32_t last_publish_{0};   // ms timestamp of the last publish
 };
 #endif
 
@@ -103,15 +323,18 @@ class BTHomeSensor {
 #ifdef USE_BINARY_SENSOR
 class BTHomeBinarySensor {
  public:
+  BTHomeBinarySensor() = default;
   BTHomeBinarySensor(uint8_t object_id, binary_sensor::BinarySensor *sensor)
       : object_id_(object_id), sensor_(sensor) {}
 
   uint8_t get_object_id() const { return this->object_id_; }
+  // Dispatch key: binary sensors are kept sorted by object_id
+  uint16_t get_key() const { return this->object_id_; }
   binary_sensor::BinarySensor *get_sensor() { return this->sensor_; }
 
  protected:
-  uint8_t object_id_;
-  binary_sensor::BinarySensor *sensor_;
+  uint8_t object_id_{0};
+  binary_sensor::BinarySensor *sensor_{nullptr};
 };
 #endif
 
@@ -121,18 +344,154 @@ class BTHomeBinarySensor {
 #ifdef USE_TEXT_SENSOR
 class BTHomeTextSensor {
  public:
+  BTHomeTextSensor() = default;
   BTHomeTextSensor(uint8_t object_id, text_sensor::TextSensor *sensor)
       : object_id_(object_id), sensor_(sensor) {}
 
   uint8_t get_object_id() const { return this->object_id_; }
+  // Dispatch key: text sensors are kept sorted by object_id
+  uint16_t get_key() const { return this->object_id_; }
   text_sensor::TextSensor *get_sensor() { return this->sensor_; }
 
  protected:
-  uint8_t object_id_;
-  text_sensor::TextSensor *sensor_;
+  uint8_t object_id_{0};
+  text_sensor::TextSensor *sensor_{nullptr};
 };
 #endif
 
+// =============================================================================
+// EntityTable - Entities of one device, sorted by dispatch key, in storage owned by the caller.
+// The sensor platforms emit one static array per device sized to its configured entities and
+// register them in key order, so setup() never allocates and each insert is an append.
+// =============================================================================
+template<typename T> class EntityTable {
+ public:
+  void set_storage(T *storage, uint16_t capacity) {
+    this->data_ = storage;
+    this->capacity_ = capacity;
+    this->size_ = 0;
+  }
+
+  // Insert keeping entries sorted by get_key(). Returns false when the storage is full.
+  bool insert(const T &entry) {
+    if (this->size_ >= this->capacity_) {
+      return false;
+    }
+    uint16_t pos = this->size_++;
+    while (pos > 0 && this->data_[pos - 1].get_key() > entry.get_key()) {
+      this->data_[pos] = this->data_[pos - 1];
+      pos--;
+    }
+    this->data_[pos] = entry;
+    return true;
+  }
+
+  // Entry with the given key, or nullptr (binary search)
+  T *find(uint16_t key) {
+    T *it = std::lower_bound(this->begin(), this->end(), key,
+                             [](const T &entry, uint16_t k) { return entry.get_key() < k; });
+    return it != this->end() && it->get_key() == key ? it : nullptr;
+  }
+
+  T *begin() { return this->data_; }
+  T *end() { return this->data_ + this->size_; }
+  uint16_t size() const { return this->size_; }
+  uint16_t capacity() const { return this->capacity_; }
+
+ protected:
+  T *data_{nullptr};
+  uint16_t size_{0};
+  uint16_t capacity_{0};
+};
+
+// A measurement payload never holds more objects than this (the smallest object is ID + 1 byte)
+static const size_t MAX_PACKET_OBJECTS = MAX_SERVICE_DATA_SIZE / 2;
+// Packet shapes remembered per device; senders often alternate between two packet formats
+static const size_t LAYOUT_SHAPES = 2;
+
+// =============================================================================
+// ObjectOccurrences - Per-packet occurrence index of each object ID (0 = first, 1 = second, ...).
+// A packet holds at most MAX_PACKET_OBJECTS objects, so a short list replaces clearing a
+// 256-entry table for every packet. Once the list is full, new IDs get index 0 and overflowed()
+// is set, so the caller must not learn a layout from the packet.
+// =============================================================================
+class ObjectOccurrences {
+ public:
+  uint8_t next(uint8_t object_id) {
+    // Objects are sorted by ID, so a repeat is almost always the last entry
+    for (uint8_t i = this->size_; i > 0; i--) {
+      if (this->ids_[i - 1] == object_id) {
+        return this->counts_[i - 1]++;
+      }
+    }
+    if (this->size_ < MAX_PACKET_OBJECTS) {
+      this->ids_[this->size_] = object_id;
+      this->counts_[this->size_++] = 1;
+    } else {
+      this->overflowed_ = true;
+    }
+    return 0;
+  }
+
+  bool overflowed() const { return this->overflowed_; }
+
+ protected:
+  uint8_t ids_[MAX_PACKET_OBJECTS];
+  uint8_t counts_[MAX_PACKET_OBJECTS];
+  uint8_t size_{0};
+  bool overflowed_{false};
+};
+
+// =============================================================================
+// PacketShape - Learned layout of a repeat-format packet: the object ID bytes and where they
+// sit, plus one entry per object that has an entity. Offsets follow from the IDs alone, so a
+// payload with the same length and the same ID bytes has exactly this layout.
+// =============================================================================
+struct LayoutEntry {
+  uint8_t offset;     // Offset of the value in the payload
+  uint8_t object_id;
+  uint8_t index;      // Occurrence of object_id within the packet
+  const bthome_codec::ObjectTypeInfo *info;  // Width, sign and factor
+#ifdef USE_SENSOR
+  BTHomeSensor *sensor;
+#endif
+#ifdef USE_BINARY_SENSOR
+  BTHomeBinarySensor *binary_sensor;
+#endif
+};
+
+struct PacketShape {
+  uint8_t payload_len{0};  // 0 = unused
+  uint8_t object_count{0};
+  uint8_t entry_count{0};
+  uint8_t id_offsets[MAX_PACKET_OBJECTS];
+  uint8_t ids[MAX_PACKET_OBJECTS];
+  LayoutEntry entries[MAX_PACKET_OBJECTS];
+};
+
+// =============================================================================
+// PacketLayoutCache - The last LAYOUT_SHAPES packet shapes of one device, in storage emitted by
+// the sensor platforms. Shapes are learned by the generic parser and replaced round-robin.
+// =============================================================================
+class PacketLayoutCache {
+ public:
+  // Shape with this payload length and ID bytes, or nullptr
+  const PacketShape *match(const uint8_t *data, size_t len);
+  // Remember a shape learned by the generic parser, replacing the oldest one
+  void store(const PacketShape &shape);
+  // Forget every shape (entity pointers in the entries may have moved)
+  void clear();
+
+  uint32_t get_hits() const { return this->hits_; }
+  uint32_t get_learned() const { return this->learned_; }
+
+ protected:
+  PacketShape shapes_[LAYOUT_SHAPES];
+  uint8_t next_slot_{0};
+  uint32_t hits_{0};
+  uint32_t learned_{0};
+};
+
 // =============================================================================
 // BTHomeButtonTrigger - Automation trigger for button events
 // =============================================================================
@@ -145,6 +504,8 @@ class BTHomeButtonTrigger : public Trigger<>, public Parented<BTHomeDevice> {
 
   uint8_t get_button_index() const { return this->button_index_; }
   uint8_t get_event_type() const { return this->event_type_; }
+  // Dispatch key: triggers are kept sorted by (button_index, event_type)
+  uint16_t get_key() const { return (static_cast<uint16_t>(this->button_index_) << 8) | this->event_type_; }
 
  protected:
   uint8_t button_index_{0};
@@ -159,6 +520,123 @@ class BTHomeDimmerTrigger : public Trigger<int8_t>, public Parented<BTHomeDevice
   explicit BTHomeDimmerTrigger(BTHomeDevice *parent) : Parented(parent) {}
 };
 
+// =============================================================================
+// BTHomeMeasurementTrigger - Generic fan-out for auto-provisioned devices
+// Fires with (mac, object_id, index, value) for each decoded sensor or binary (0/1) object
+// =============================================================================
+class BTHomeMeasurementTrigger : public Trigger<uint64_t, uint8_t, uint8_t, float> {
+ public:
+  // Restrict the trigger to one object ID (default: every object)
+  void set_object_id(uint8_t object_id) {
+    this->object_id_ = object_id;
+    this->any_object_ = false;
+  }
+  bool matches(uint8_t object_id) const { return this->any_object_ || this->object_id_ == object_id; }
+
+ protected:
+  uint8_t object_id_{0};
+  bool any_object_{true};
+};
+
+// =============================================================================
+// BTHomeDeviceStats - Link and decode counters for one device, updated in O(1) per packet
+// =============================================================================
+struct BTHomeDeviceStats {
+  uint32_t packets{0};           // New (non-duplicate) packets that passed decryption
+  uint32_t duplicates{0};        // Retransmissions skipped
+  uint32_t lost{0};              // Estimated from packet_id / encryption counter gaps
+  uint32_t decrypt_failures{0};  // MIC mismatch, or encrypted data without a key
+  uint32_t replays{0};           // Encryption counter did not increase
+  uint32_t parse_errors{0};      // Truncated data or unknown object IDs
+  int16_t rssi_x16{0};           // RSSI moving average in 1/16 dBm
+  bool has_rssi{false};
+};
+
+// =============================================================================
+// DedupState - Retransmission detection for one sender: packet_id (object 0x00) when the
+// sender includes it in the clear, otherwise a 32-bit FNV-1a hash plus length of the whole
+// service data. The same struct holds the key of a single packet.
+// =============================================================================
+struct DedupState {
+  uint32_t fingerprint{0};
+  uint8_t fingerprint_len{0};  // 0 = no fingerprint stored
+  uint8_t last_packet_id{0};
+  bool has_packet_id{false};
+};
+
+// Dedup key of service_data (len >= 1)
+DedupState make_dedup_key(const uint8_t *service_data, size_t len);
+// Returns true if key repeats the last accepted packet. Does not change state.
+bool is_duplicate_packet(const DedupState &state, const DedupState &key);
+// Make key the reference for later packets. Call only once the packet has been decrypted and its
+// counter checked, so a forged frame never hides the genuine retransmits after it.
+// Returns the number of packet_ids skipped since the previous packet (0 when unknown).
+uint32_t commit_packet(DedupState &state, const DedupState &key);
+
+// BTHome v2 AES-CCM decryption. nonce_prefix is MAC(6, little-endian) + UUID(2, little-endian),
+// data is everything after device_info: ciphertext + counter(4) + MIC(4).
+bool decrypt_bthome_payload(mbedtls_ccm_context *ctx, const uint8_t *nonce_prefix, const uint8_t *data,
+                            size_t data_len, uint8_t device_info, uint32_t counter, uint8_t *plaintext,
+                            size_t *plaintext_len);
+
+// =============================================================================
+// CompactDeviceTable - Dense-gateway storage for auto-provisioned senders
+// Per-device state lives in parallel arrays carved out of one block allocated in setup()
+// (optionally in PSRAM), together with the MAC index and the key slots' CCM contexts, so a sender
+// costs a few dozen bytes instead of a BTHomeDevice. Rows are claimed once and never freed.
+// Setting a key is the one exception to the single block: mbedtls_ccm_setkey() allocates the
+// cipher's AES context on the heap, once per key slot in use.
+// =============================================================================
+class CompactDeviceTable {
+ public:
+  static constexpr uint16_t NONE = 0xFFFF;
+
+  // Carve every array out of one allocation. Returns false if it failed.
+  bool allocate(uint16_t capacity, uint16_t key_slots, bool psram);
+
+  // Row holding mac, or NONE
+  uint16_t find(uint64_t mac) const;
+  // Row holding mac, claiming a free one for a new sender. NONE when the table is full.
+  uint16_t claim(uint64_t mac);
+  // Give row a key slot (re-keying the one it already has). Returns false when no slot is left.
+  bool set_key(uint16_t row, const std::array<uint8_t, AES_KEY_SIZE> &key);
+  mbedtls_ccm_context *get_key(uint16_t row) const {
+    return this->key_slot_[row] == NONE ? nullptr : &this->keys_[this->key_slot_[row]];
+  }
+
+  uint16_t size() const { return this->size_; }
+  uint16_t capacity() const { return this->capacity_; }
+  uint16_t get_key_slots() const { return this->key_slots_; }
+  uint16_t get_key_slots_used() const { return this->keys_used_; }
+  size_t get_allocated_bytes() const { return this->allocated_bytes_; }
+  // Bytes per device: row arrays plus the device's share of the MAC index. Key slots are excluded,
+  // as is the AES context mbedtls allocates on the heap for each key slot in use.
+  size_t get_bytes_per_device() const;
+
+  // Row state, indexed by row
+  uint64_t *mac{nullptr};
+  DedupState *dedup{nullptr};
+  uint32_t *counter{nullptr};  // Last accepted encryption counter
+  uint32_t *packets{nullptr};  // New (non-duplicate) packets
+  uint16_t *lost{nullptr};     // Estimated from packet_id / counter gaps, saturating
+  uint16_t *errors{nullptr};   // Decrypt failures, replays and parse errors, saturating
+  int8_t *rssi{nullptr};       // RSSI of the last report
+
+ protected:
+  uint8_t *block_{nullptr};
+  size_t allocated_bytes_{0};
+  uint16_t capacity_{0};
+  uint16_t size_{0};
+  uint16_t *key_slot_{nullptr};  // Index into keys_, NONE = no key
+  // MAC -> row lookup, open addressing with linear probing like the hub's device index.
+  // Each slot holds (row + 1), 0 marks an empty slot.
+  uint16_t *index_{nullptr};
+  uint32_t index_mask_{0};
+  mbedtls_ccm_context *keys_{nullptr};  // CCM contexts, assigned to rows in claim order
+  uint16_t key_slots_{0};
+  uint16_t keys_used_{0};
+};
+
 // =============================================================================
 // BTHomeDevice - Represents a single BTHome BLE device being monitored
 // =============================================================================
@@ -166,47 +644,90 @@ class BTHomeDevice : public Parented<BTHomeReceiverHub> {
  public:
   explicit BTHomeDevice(BTHomeReceiverHub *parent) : Parented(parent) {}
 
-  void set_mac_address(uint64_t mac) { this->address_ = mac; }
+  void set_mac_address(uint64_t mac);
   void set_name(const std::string &name) { this->name_ = name; }
   void set_encryption_key(const std::array<uint8_t, AES_KEY_SIZE> &key);
 
   uint64_t get_mac_address() const { return this->address_; }
   const std::string &get_name() const { return this->name_; }
 
-  // Parse incoming BLE advertisement
-  bool parse_advertisement(const std::vector<uint8_t> &service_data);
+  // Auto-provisioned devices have no entities; their values go to the hub's measurement triggers
+  void set_auto_provisioned(bool auto_provisioned) { this->auto_provisioned_ = auto_provisioned; }
+  bool is_auto_provisioned() const { return this->auto_provisioned_; }
+  uint32_t get_duplicate_count() const { return this->stats_.duplicates; }
+  const BTHomeDeviceStats &get_stats() const { return this->stats_; }
+  float get_rssi() const { return this->stats_.rssi_x16 / 16.0f; }
+
+  // Record the RSSI of a received report (duplicates included)
+  void record_rssi(int8_t rssi);
 
 #ifdef USE_SENSOR
-  void add_sensor(uint8_t object_id, uint8_t index, sensor::Sensor *sensor) {
-    this->sensors_.push_back(new BTHomeSensor(object_id, index, sensor));
+  // Optional diagnostic sensors, published every STATS_PUBLISH_INTERVAL_MS
+  void set_rssi_sensor(sensor::Sensor *sensor) { this->rssi_sensor_ = sensor; }
+  void set_packet_rate_sensor(sensor::Sensor *sensor) { this->packet_rate_sensor_ = sensor; }
+  void set_packet_loss_sensor(sensor::Sensor *sensor) { this->packet_loss_sensor_ = sensor; }
+  bool has_stats_sensors() const {
+    return this->rssi_sensor_ != nullptr || this->packet_rate_sensor_ != nullptr ||
+           this->packet_loss_sensor_ != nullptr;
   }
+  void publish_stats(uint32_t now);
 #endif
 
+  // Observed advertising behaviour (ms), used by the adaptive scan scheduler
+  uint32_t get_last_seen() const { return this->last_seen_; }
+  uint32_t get_advertising_interval() const { return this->adv_interval_; }  // 0 = not learned yet
+
+  // Parse incoming BLE advertisement (service data after the UUID, borrowed from the caller's buffer)
+  bool parse_advertisement(const uint8_t *service_data, size_t len);
+
+  // Entity storage, one static array per device emitted by the sensor platforms. Must be set
+  // before the matching add_*() calls.
+#ifdef USE_SENSOR
+  void set_sensor_storage(BTHomeSensor *storage, uint16_t capacity) { this->sensors_.set_storage(storage, capacity); }
+#endif
 #ifdef USE_BINARY_SENSOR
-  void add_binary_sensor(uint8_t object_id, binary_sensor::BinarySensor *sensor) {
-    this->binary_sensors_.push_back(new BTHomeBinarySensor(object_id, sensor));
+  void set_binary_sensor_storage(BTHomeBinarySensor *storage, uint16_t capacity) {
+    this->binary_sensors_.set_storage(storage, capacity);
   }
 #endif
-
 #ifdef USE_TEXT_SENSOR
-  void add_text_sensor(uint8_t object_id, text_sensor::TextSensor *sensor) {
-    this->text_sensors_.push_back(new BTHomeTextSensor(object_id, sensor));
+  void set_text_sensor_storage(BTHomeTextSensor *storage, uint16_t capacity) {
+    this->text_sensors_.set_storage(storage, capacity);
   }
 #endif
 
-  void add_button_trigger(BTHomeButtonTrigger *trigger) { this->button_triggers_.push_back(trigger); }
-  void add_dimmer_trigger(BTHomeDimmerTrigger *trigger) { this->dimmer_triggers_.push_back(trigger); }
+  // Entity registration keeps each table sorted by its dispatch key, so lookups are a binary search
+#ifdef USE_SENSOR
+  void add_sensor(uint8_t object_id, uint8_t index, sensor::Sensor *sensor, int32_t deadband = -1,
+                  uint32_t heartbeat = 0);
+#endif
 
- protected:
-  // Decrypt encrypted payload using AES-128-CCM
-  bool decrypt_payload_(const uint8_t *ciphertext, size_t ciphertext_len, const uint8_t *mac,
-                        uint8_t device_info, uint32_t counter, uint8_t *plaintext, size_t *plaintext_len);
+#ifdef USE_BINARY_SENSOR
+  void add_binary_sensor(uint8_t object_id, binary_sensor::BinarySensor *sensor);
+#endif
+
+#ifdef USE_TEXT_SENSOR
+  void add_text_sensor(uint8_t object_id, text_sensor::TextSensor *sensor);
+#endif
+
+  void add_button_trigger(BTHomeButtonTrigger *trigger);
+  void add_dimmer_trigger(BTHomeDimmerTrigger *trigger);
 
+  // Decode repeat-format packets through learned layouts (storage emitted by the sensor platforms)
+  void set_layout_cache(PacketLayoutCache *cache) { this->layout_cache_ = cache; }
+  const PacketLayoutCache *get_layout_cache() const { return this->layout_cache_; }
+
+ protected:
   // Parse measurement objects from payload
   void parse_measurements_(const uint8_t *data, size_t len);
+  // Add one decoded object to the shape being learned. Returns false if the packet can't be cached.
+  bool learn_object_(PacketShape &shape, size_t object_pos, const bthome_codec::DecodedObject &obj, uint8_t index,
+                     const uint8_t *data);
+  // Publish a payload matching a learned shape, straight from its entries
+  void publish_layout_(const PacketShape &shape, const uint8_t *data);
 
   // Publish values to registered sensors
-  void publish_sensor_value_(uint8_t object_id, uint8_t index, float value);
+  void publish_sensor_value_(uint8_t object_id, uint8_t index, int64_t raw_value, float factor);
   void publish_binary_sensor_value_(uint8_t object_id, bool value);
   void publish_text_value_(uint8_t object_id, const std::string &value);
 
@@ -216,27 +737,64 @@ class BTHomeDevice : public Parented<BTHomeReceiverHub> {
 
   uint64_t address_{0};
   std::string name_;
+  bool auto_provisioned_{false};
 
   // Encryption
   bool encryption_enabled_{false};
-  std::array<uint8_t, AES_KEY_SIZE> encryption_key_{};
+  // CCM context keyed once in set_encryption_key(), valid while encryption_enabled_ is set.
+  // Stored by value; mbedtls_ccm_setkey() still allocates the cipher's AES context on the heap.
+  mbedtls_ccm_context ccm_ctx_;
+  // Constant nonce prefix: MAC(6, little-endian) + UUID(2, little-endian)
+  uint8_t nonce_prefix_[8]{};
   uint32_t last_counter_{0};
 
-  // Deduplication - store last received service data to skip duplicate packets
-  std::vector<uint8_t> last_service_data_;
+  // Deduplication of retransmitted packets
+  DedupState dedup_;
+
+  PacketLayoutCache *layout_cache_{nullptr};
+
+  BTHomeDeviceStats stats_;
+  // Count packets missing between two consecutive sequence numbers (packet_id or counter)
+  void count_gap_(uint32_t gap) {
+    if (gap > 0 && gap <= MAX_COUNTED_PACKET_GAP)
+      this->stats_.lost += gap;
+  }
+#ifdef USE_SENSOR
+  sensor::Sensor *rssi_sensor_{nullptr};
+  sensor::Sensor *packet_rate_sensor_{nullptr};
+  sensor::Sensor *packet_loss_sensor_{nullptr};
+  // Counter values at the previous stats publish, for per-interval rates
+  uint32_t stats_last_time_{0};
+  uint32_t stats_last_packets_{0};
+  uint32_t stats_last_lost_{0};
+#endif
+
+  // Advertising interval estimate: moving average of the gaps between new (non-duplicate) packets
+  void note_packet_(uint32_t now);
+  bool seen_{false};
+  uint32_t last_seen_{0};
+  uint32_t adv_interval_{0};
+
+  // One bit per object ID that has at least one entity or trigger registered.
+  // Lets the publish path reject unused objects (packet_id, unconfigured values) with a single test.
+  std::array<uint32_t, 8> dispatch_mask_{};
+  void set_dispatch_bit_(uint8_t object_id) { this->dispatch_mask_[object_id >> 5] |= 1u << (object_id & 31); }
+  bool has_dispatch_(uint8_t object_id) const {
+    return (this->dispatch_mask_[object_id >> 5] & (1u << (object_id & 31))) != 0;
+  }
 
-  // Sensors
+  // Sensors (sorted by dispatch key)
 #ifdef USE_SENSOR
-  std::vector<BTHomeSensor *> sensors_;
+  EntityTable<BTHomeSensor> sensors_;
 #endif
 #ifdef USE_BINARY_SENSOR
-  std::vector<BTHomeBinarySensor *> binary_sensors_;
+  EntityTable<BTHomeBinarySensor> binary_sensors_;
 #endif
 #ifdef USE_TEXT_SENSOR
-  std::vector<BTHomeTextSensor *> text_sensors_;
+  EntityTable<BTHomeTextSensor> text_sensors_;
 #endif
 
-  // Event triggers
+  // Event triggers (button triggers sorted by dispatch key)
   std::vector<BTHomeButtonTrigger *> button_triggers_;
   std::vector<BTHomeDimmerTrigger *> dimmer_triggers_;
 };
@@ -246,6 +804,8 @@ class BTHomeDevice : public Parented<BTHomeReceiverHub> {
 // =============================================================================
 #ifdef USE_BTHOME_RECEIVER_BLUEDROID
 class BTHomeReceiverHub : public Component, public esphome::esp32_ble_tracker::ESPBTDeviceListener {
+#elif defined(USE_BTHOME_RECEIVER_NIMBLE)
+class BTHomeReceiverHub : public Component, public bthome_nimble::NimBLEHostListener {
 #else
 class BTHomeReceiverHub : public Component {
 #endif
@@ -261,57 +821,263 @@ class BTHomeReceiverHub : public Component {
   // Set interval for periodic dump of all detected devices (in ms, 0 = disabled)
   void set_dump_interval(uint32_t interval) { this->dump_interval_ = interval; }
 
+  // Set the number of devices the discovery cache holds before evicting the least recently seen
+  void set_discovery_cache_size(uint16_t size) { this->detected_capacity_ = size; }
+
+  // Auto-provisioning: unknown senders whose MAC matches a prefix get a device from a pool of
+  // pool_size devices allocated once in setup(). 0 = disabled.
+  void set_auto_provision_pool_size(uint16_t size) { this->pool_capacity_ = size; }
+  void add_auto_provision_prefix(uint64_t prefix, uint64_t mask) {
+    this->provision_prefixes_.push_back({prefix & mask, mask});
+  }
+  void add_measurement_trigger(BTHomeMeasurementTrigger *trigger);
+  // Gateway profile: keep the pool in a CompactDeviceTable instead of BTHomeDevice objects, with
+  // key_slots encryption keys, allocated in PSRAM when psram is set and available
+  void set_auto_provision_compact(uint16_t key_slots, bool psram) {
+    this->compact_pool_ = true;
+    this->compact_key_slots_ = key_slots;
+    this->compact_psram_ = psram;
+  }
+
+  // Claim a pool device for mac, e.g. for a list of senders loaded at runtime. Returns the existing
+  // device if mac is already known, nullptr when auto-provisioning is off, the pool is full or the
+  // pool is compact (use provision_sender() there).
+  BTHomeDevice *provision_device(uint64_t mac);
+  // Claim a pool slot for mac in either storage mode. Returns false when the pool is off or full.
+  bool provision_sender(uint64_t mac);
+  // Compact pool only: claim a slot for an encrypted sender and assign it one of the key slots
+  bool provision_sender(uint64_t mac, const std::array<uint8_t, AES_KEY_SIZE> &key);
+  size_t get_provisioned_count() const {
+    return this->compact_pool_ ? this->compact_table_.size() : this->pool_.size();
+  }
+  const CompactDeviceTable &get_compact_table() const { return this->compact_table_; }
+
+  // Deliver a value decoded from an auto-provisioned device to the matching measurement triggers
+  void fan_out_measurement(uint64_t mac, uint8_t object_id, uint8_t index, float value);
+
+  // Startup timing: ms from boot until the first value reached a sensor or measurement trigger (0 = not yet)
+  uint32_t get_boot_to_first_publish_ms() const { return this->first_publish_ms_; }
+  // Called by every path that publishes a decoded value
+  void note_publish() {
+    if (this->first_publish_ms_ == 0) {
+      this->note_first_publish_();
+    }
+  }
+
 #ifdef USE_BTHOME_RECEIVER_BLUEDROID
-  // ESPBTDeviceListener interface - called when BLE advertisement is received
+  // ESPBTDeviceListener interface. The hub asks for raw advertisements, so the tracker hands over
+  // whole batches of scan results without building an ESPBTDevice for each report.
+  esphome::esp32_ble_tracker::AdvertisementParserType get_advertisement_parser_type() override {
+    return esphome::esp32_ble_tracker::AdvertisementParserType::RAW_ADVERTISEMENTS;
+  }
+  bool parse_devices(const esphome::esp32_ble::BLEScanResult *scan_results, size_t count) override;
   bool parse_device(const esphome::esp32_ble_tracker::ESPBTDevice &device) override;
 #endif
 
 #ifdef USE_BTHOME_RECEIVER_NIMBLE
-  // Process advertisement received via NimBLE
-  void process_nimble_advertisement(const struct ble_gap_disc_desc *disc);
+  // Process an advertisement received via NimBLE (called from loop() as the queue drains)
+  void process_nimble_advertisement(const RawAdvertisement &adv);
+
+  // NimBLEHostListener interface (NimBLE host task)
+  void on_host_sync() override;
+  void on_host_reset(int reason) override;
+
+  // Advertisement queue statistics
+  uint32_t get_queue_drops() const { return this->adv_queue_.get_drops(); }
+  uint32_t get_queue_high_water() const { return this->adv_queue_.get_high_water(); }
+
+  // Let the controller drop reports: duplicate filtering always, plus an accept list of the
+  // registered MACs while discovery (dump_interval) is off
+  void set_controller_filter(bool controller_filter) { this->controller_filter_ = controller_filter; }
+  uint32_t get_reports_received() const { return this->reports_received_; }
+
+  // Adapt the scan window to when registered devices are expected (default: fixed 50% duty)
+  void set_adaptive_scan(bool adaptive_scan) { this->adaptive_scan_ = adaptive_scan; }
+
+  // Scan scheduler metrics
+  ScanDuty get_scan_duty() const { return this->scan_duty_; }
+  uint8_t get_scan_duty_percent() const { return this->scan_window_() * 100 / SCAN_INTERVAL; }
+  uint32_t get_scan_duty_time(ScanDuty duty) const { return this->scan_duty_time_[duty]; }  // ms spent
+  uint32_t get_scan_duty_changes() const { return this->scan_duty_changes_; }
+
+  // Startup timing: ms from boot until scanning first started (0 = not yet)
+  uint32_t get_boot_to_first_scan_ms() const { return this->first_scan_ms_; }
+#endif
+
+#ifdef USE_BTHOME_RECEIVER_METRICS
+  // Receive pipeline metrics, summarized to the log (and diagnostic sensors) every interval
+  void set_metrics_interval(uint32_t interval) { this->metrics_interval_ = interval; }
+  void record_stage(PipelineStage stage, uint32_t us) { this->stage_latency_[stage].record(us); }
+  const LatencyHistogram &get_stage_latency(PipelineStage stage) const { return this->stage_latency_[stage]; }
+  uint32_t get_reports_seen() const { return this->reports_seen_.load(std::memory_order_relaxed); }
+  uint32_t get_bthome_reports() const { return this->bthome_reports_.load(std::memory_order_relaxed); }
+#ifdef USE_SENSOR
+  void set_advertisement_rate_sensor(sensor::Sensor *sensor) { this->advertisement_rate_sensor_ = sensor; }
+  void set_hit_rate_sensor(sensor::Sensor *sensor) { this->hit_rate_sensor_ = sensor; }
+  void set_queue_drops_sensor(sensor::Sensor *sensor) { this->queue_drops_sensor_ = sensor; }
+  void set_stage_latency_sensor(PipelineStage stage, sensor::Sensor *sensor) {
+    this->stage_latency_sensors_[stage] = sensor;
+  }
+#endif
 #endif
 
  protected:
-  // Device registry - using vector for small dataset optimization (typically <10 devices)
+  // Device registry (registration order, used for dump_config)
   std::vector<BTHomeDevice *> devices_;
 
+  // MAC -> device lookup index, open addressing with linear probing.
+  // Each slot holds (position in devices_ + 1), 0 marks an empty slot. Built in setup() with
+  // a power-of-two size of at least twice the device count, so probes stay short.
+  std::vector<uint16_t> device_index_;
+  uint32_t device_index_mask_{0};
+
   // Periodic dump interval (ms, 0 = disabled)
   uint32_t dump_interval_{0};
   uint32_t last_dump_time_{0};
 
-  // Cache of detected BTHome devices for periodic dump
-  // Stores: MAC address -> (last_data, last_seen_time)
+  // Cache of detected BTHome devices for periodic dump.
+  // A fixed arena of detected_capacity_ slots allocated once in setup(), a MAC -> slot index
+  // using the same open addressing scheme as device_index_, and an intrusive LRU list so the
+  // least recently seen device is evicted in O(1) once the arena is full.
+  static constexpr uint16_t DETECTED_NONE = 0xFFFF;
   struct DetectedDevice {
-    std::vector<uint8_t> last_data;
+    uint64_t address{0};
     uint32_t last_seen{0};
+    uint16_t lru_prev{DETECTED_NONE};  // Towards the most recently seen device
+    uint16_t lru_next{DETECTED_NONE};  // Towards the least recently seen device
+    uint8_t last_data_len{0};
+    uint8_t last_data[MAX_SERVICE_DATA_SIZE];
+  };
+  uint16_t detected_capacity_{DEFAULT_DISCOVERY_CACHE_SIZE};
+  std::vector<DetectedDevice> detected_devices_;
+  std::vector<uint16_t> detected_index_;  // Slot holds (arena position + 1), 0 = empty
+  uint32_t detected_index_mask_{0};
+  uint16_t detected_lru_head_{DETECTED_NONE};  // Most recently seen
+  uint16_t detected_lru_tail_{DETECTED_NONE};  // Least recently seen, evicted first
+  uint32_t detected_evictions_{0};
+  uint32_t last_stats_time_{0};
+  uint16_t dump_cursor_{DETECTED_NONE};  // Next arena position to dump, DETECTED_NONE when idle
+  uint32_t first_publish_ms_{0};
+  void note_first_publish_();
+
+  // Auto-provisioning pool. pool_ and devices_ are reserved in setup() and never grow past it,
+  // so device pointers and index positions stay valid as devices are claimed.
+  struct ProvisionPrefix {
+    uint64_t prefix;
+    uint64_t mask;
   };
-  std::vector<std::pair<uint64_t, DetectedDevice>> detected_devices_;
+  uint16_t pool_capacity_{0};
+  std::vector<BTHomeDevice> pool_;
+  std::vector<ProvisionPrefix> provision_prefixes_;
+  uint32_t provision_rejections_{0};  // Reports from matching senders while the pool was full
+  std::vector<BTHomeMeasurementTrigger *> measurement_triggers_;
+  bool matches_provision_prefix_(uint64_t address) const;
+
+  // Compact pool (gateway profile): senders never get a BTHomeDevice or a device_index_ slot
+  bool compact_pool_{false};
+  uint16_t compact_key_slots_{0};
+  bool compact_psram_{false};
+  CompactDeviceTable compact_table_;
+  // Dedup, decrypt and decode one report of a compact row, fanning values out to the triggers
+  bool parse_compact_(uint16_t row, const uint8_t *service_data, size_t len);
 
   // Dump an advertisement to the log (for discovery mode)
   void dump_advertisement_(uint64_t address, const uint8_t *data, size_t len);
 
-  // Find a device by MAC address (linear search, efficient for small datasets)
+  // Cache, look up and parse the BTHome service data (after the UUID) of one scan report.
+  // Returns true if a registered device handled it.
+  bool handle_service_data_(uint64_t address, int8_t rssi, const uint8_t *service_data, size_t len);
+
+  // Find a device by MAC address (O(1) average via device_index_)
   BTHomeDevice *find_device_(uint64_t address);
 
+  // (Re)build device_index_ from devices_, sized for the auto-provision pool as well
+  void build_device_index_();
+  // Insert devices_[pos] into device_index_ (the first registration for a MAC wins)
+  void index_device_(size_t pos);
+
   // Cache device data for periodic dump
   void cache_device_data_(uint64_t address, const uint8_t *data, size_t len);
 
-  // Dump all cached devices (for periodic summary)
-  void dump_all_devices_();
+  // Discovery cache helpers
+  void allocate_discovery_cache_();
+  uint32_t find_detected_slot_(uint64_t address) const;
+  void unlink_detected_(uint16_t pos);
+  void remove_detected_index_(uint32_t slot);
+
+  // Dump the next DUMP_DEVICES_PER_LOOP cached devices of the periodic summary
+  void dump_next_devices_(uint32_t now);
 
 #ifdef USE_BTHOME_RECEIVER_NIMBLE
-  // NimBLE-specific members
-  bool nimble_initialized_{false};
-  bool init_attempted_{false};
+  // NimBLE bring-up state machine, advanced by loop() without blocking. The host task only sets
+  // nimble_synced_ and scan_requests_; scanning is started and stopped from loop() alone.
+  enum NimbleState : uint8_t { NIMBLE_IDLE, NIMBLE_WAIT_SYNC, NIMBLE_READY, NIMBLE_FAILED };
+  NimbleState nimble_state_{NIMBLE_IDLE};
+  std::atomic<bool> nimble_synced_{false};
+  uint32_t nimble_init_time_{0};  // ms, when the host task was started
+  uint32_t first_scan_ms_{0};
+  // Host task events that loop() acts on, see apply_scan_requests_()
+  enum ScanRequest : uint8_t {
+    SCAN_REQUEST_SYNC = 1 << 0,      // Host (re)synced, the controller lost its accept list
+    SCAN_REQUEST_RESET = 1 << 1,     // Host reset, discovery was stopped
+    SCAN_REQUEST_COMPLETE = 1 << 2,  // Discovery ended on its own
+  };
+  std::atomic<uint8_t> scan_requests_{0};
   bool scanning_{false};
+  // Scan reports queued by the GAP callback (host task), drained in loop()
+  SPSCQueue<RawAdvertisement, ADV_QUEUE_SIZE> adv_queue_;
   static BTHomeReceiverHub *instance_;  // For NimBLE callbacks
-  static void nimble_host_task_(void *param);
-  static void nimble_on_sync_();
-  static void nimble_on_reset_(int reason);
   static int nimble_gap_event_(struct ble_gap_event *event, void *arg);
   void init_nimble_();
+  void apply_scan_requests_();
   void start_scanning_();
   void stop_scanning_();
+  // Scan window for the current duty, capped while the broadcaster is advertising
+  uint16_t scan_window_() const {
+    uint16_t window = SCAN_WINDOWS[this->scan_duty_];
+    return bthome_nimble::NimBLEHost::is_advertising() ? std::min(window, SCAN_WINDOW_SHARED) : window;
+  }
+  uint16_t active_scan_window_{0};  // Window of the running scan, restarted when scan_window_() changes
+
+  // Controller-side filtering
+  bool controller_filter_{false};
+  bool accept_list_programmed_{false};  // Cleared on host sync/reset, the controller forgets the list
+  bool accept_list_failed_{false};      // Too many devices for the controller, don't retry
+  uint32_t reports_received_{0};        // Reports that reached process_nimble_advertisement()
+  bool program_accept_list_();
+
+  // Adaptive scan scheduler
+  bool adaptive_scan_{false};
+  ScanDuty scan_duty_{SCAN_DUTY_NORMAL};
+  uint32_t scan_duty_time_[SCAN_DUTY_COUNT]{};
+  uint32_t scan_duty_changes_{0};
+  uint32_t last_schedule_time_{0};
+  uint32_t schedule_reports_{0};  // Reports drained since the last evaluation
+  void update_scan_schedule_(uint32_t now);
+  ScanDuty choose_scan_duty_(uint32_t now);
+#endif
+
+#ifdef USE_BTHOME_RECEIVER_METRICS
+  // Counted where the reports arrive (the NimBLE host task, or loop() for Bluedroid)
+  std::atomic<uint32_t> reports_seen_{0};    // Every scan report handed to the radio callback
+  std::atomic<uint32_t> bthome_reports_{0};  // Reports that passed the BTHome prefilter
+  LatencyHistogram stage_latency_[STAGE_COUNT];
+#ifdef USE_BTHOME_RECEIVER_NIMBLE
+  AtomicLatencyHistogram prefilter_latency_;  // Rejected reports never reach loop(), timed on the host task
+#endif
+  uint32_t metrics_interval_{DEFAULT_METRICS_INTERVAL_MS};
+  uint32_t last_metrics_time_{0};
+  uint32_t metrics_last_seen_{0};
+  uint32_t metrics_last_bthome_{0};
+  uint32_t metrics_last_drops_{0};
+#ifdef USE_SENSOR
+  sensor::Sensor *advertisement_rate_sensor_{nullptr};
+  sensor::Sensor *hit_rate_sensor_{nullptr};
+  sensor::Sensor *queue_drops_sensor_{nullptr};
+  sensor::Sensor *stage_latency_sensors_[STAGE_COUNT]{};
+#endif
+  // Log the interval summary, publish the diagnostic sensors and start a new interval
+  void report_metrics_(uint32_t now);
 #endif
 };
 
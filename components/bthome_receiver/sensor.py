@@ -19,13 +19,16 @@ from esphome.const import (
     DEVICE_CLASS_ILLUMINANCE,
     DEVICE_CLASS_POWER,
     DEVICE_CLASS_PRESSURE,
+    DEVICE_CLASS_SIGNAL_STRENGTH,
     DEVICE_CLASS_SPEED,
     DEVICE_CLASS_TEMPERATURE,
     DEVICE_CLASS_VOLTAGE,
+    ENTITY_CATEGORY_DIAGNOSTIC,
     STATE_CLASS_MEASUREMENT,
     STATE_CLASS_TOTAL_INCREASING,
     UNIT_AMPERE,
     UNIT_CELSIUS,
+    UNIT_DECIBEL_MILLIWATT,
     UNIT_DEGREES,
     UNIT_KILOGRAM,
     UNIT_KILOWATT_HOURS,
@@ -47,8 +50,11 @@ UNIT_METERS_PER_SECOND = "m/s"
 from . import (
     BTHomeReceiverHub,
     BTHomeDevice,
+    BTHomeSensor,
     SENSOR_TYPES,
     CONF_ENCRYPTION_KEY,
+    entity_storage,
+    layout_cache,
     validate_encryption_key,
 )
 
@@ -57,6 +63,16 @@ DEPENDENCIES = ["bthome_receiver"]
 # Configuration key for sensor index (for multiple sensors of same type)
 CONF_INDEX = "index"
 
+# Per-device link statistics (diagnostic sensors, published every minute)
+CONF_RSSI = "rssi"
+CONF_PACKET_RATE = "packet_rate"
+CONF_PACKET_LOSS = "packet_loss"
+
+# Change-aware publishing: skip publishes that moved less than deadband,
+# but still publish at least once per heartbeat
+CONF_DEADBAND = "deadband"
+CONF_HEARTBEAT = "heartbeat"
+
 # Map sensor type names to their metadata for ESPHome integration
 # Format: type_name: (device_class, unit_of_measurement, state_class, accuracy_decimals)
 SENSOR_METADATA = {
@@ -148,9 +164,11 @@ def sensor_schema(sensor_type):
     if state_class:
         schema_kwargs["state_class"] = state_class
 
-    # Base sensor schema with optional index
+    # Base sensor schema with optional index and publish suppression
     base_schema = sensor.sensor_schema(**schema_kwargs).extend({
         cv.Optional(CONF_INDEX, default=0): cv.int_range(min=0, max=255),
+        cv.Optional(CONF_DEADBAND): cv.positive_float,
+        cv.Optional(CONF_HEARTBEAT): cv.positive_time_period_milliseconds,
     })
 
     # Allow either single config or list of configs
@@ -171,6 +189,27 @@ for _sensor_type in SENSOR_TYPES.keys():
     if _schema:
         _schema_dict[cv.Optional(_sensor_type)] = _schema
 
+# Link statistics sensors
+_schema_dict[cv.Optional(CONF_RSSI)] = sensor.sensor_schema(
+    unit_of_measurement=UNIT_DECIBEL_MILLIWATT,
+    accuracy_decimals=1,
+    device_class=DEVICE_CLASS_SIGNAL_STRENGTH,
+    state_class=STATE_CLASS_MEASUREMENT,
+    entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+)
+_schema_dict[cv.Optional(CONF_PACKET_RATE)] = sensor.sensor_schema(
+    unit_of_measurement="packets/min",
+    accuracy_decimals=1,
+    state_class=STATE_CLASS_MEASUREMENT,
+    entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+)
+_schema_dict[cv.Optional(CONF_PACKET_LOSS)] = sensor.sensor_schema(
+    unit_of_measurement=UNIT_PERCENT,
+    accuracy_decimals=1,
+    state_class=STATE_CLASS_MEASUREMENT,
+    entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+)
+
 CONFIG_SCHEMA = cv.Schema(_schema_dict)
 
 
@@ -190,11 +229,13 @@ async def to_code(config):
         key_array = cg.RawExpression(f"std::array<uint8_t, 16>{{{{{', '.join(str(b) for b in key_bytes)}}}}}")
         cg.add(device_var.set_encryption_key(key_array))
 
-    # Register each configured sensor type
+    # Collect each configured sensor type as (object_id, index, factor, config)
+    entries = []
     for sensor_type, type_info in SENSOR_TYPES.items():
         if sensor_type in config:
             sensor_configs = config[sensor_type]
             object_id = type_info[0]  # First element is object_id
+            factor = type_info[3]
 
             # Normalize to list (handles both single config and list of configs)
             if not isinstance(sensor_configs, list):
@@ -202,13 +243,41 @@ async def to_code(config):
 
             for sensor_config in sensor_configs:
                 # Get index (default 0)
-                index = sensor_config.get(CONF_INDEX, 0)
+                entries.append((object_id, sensor_config.get(CONF_INDEX, 0), factor, sensor_config))
+
+    # Static table sized to the sensors, registered in dispatch key order so each add is an append
+    if entries:
+        storage = entity_storage(config[CONF_ID], BTHomeSensor, len(entries), "sensors")
+        cg.add(device_var.set_sensor_storage(storage, len(entries)))
+    for object_id, index, factor, sensor_config in sorted(entries, key=lambda e: (e[0], e[1])):
+        # Create the ESPHome sensor
+        sens = await sensor.new_sensor(sensor_config)
+
+        if CONF_DEADBAND in sensor_config or CONF_HEARTBEAT in sensor_config:
+            # Deadband is compared against raw (pre-factor) values on the device
+            deadband = round(sensor_config.get(CONF_DEADBAND, 0.0) / factor)
+            heartbeat = 0
+            if CONF_HEARTBEAT in sensor_config:
+                heartbeat = sensor_config[CONF_HEARTBEAT].total_milliseconds
+            cg.add(device_var.add_sensor(object_id, index, sens, deadband, heartbeat))
+        else:
+            # Register sensor with device (object_id, index, sensor*)
+            cg.add(device_var.add_sensor(object_id, index, sens))
 
-                # Create the ESPHome sensor
-                sens = await sensor.new_sensor(sensor_config)
+    # Repeat-format packets skip the generic parser once their layout is learned
+    if entries:
+        cg.add(device_var.set_layout_cache(layout_cache(config[CONF_ID])))
 
-                # Register sensor with device (object_id, index, sensor*)
-                cg.add(device_var.add_sensor(object_id, index, sens))
+    # Link statistics sensors
+    if CONF_RSSI in config:
+        sens = await sensor.new_sensor(config[CONF_RSSI])
+        cg.add(device_var.set_rssi_sensor(sens))
+    if CONF_PACKET_RATE in config:
+        sens = await sensor.new_sensor(config[CONF_PACKET_RATE])
+        cg.add(device_var.set_packet_rate_sensor(sens))
+    if CONF_PACKET_LOSS in config:
+        sens = await sensor.new_sensor(config[CONF_PACKET_LOSS])
+        cg.add(device_var.set_packet_loss_sensor(sens))
 
     # Register device with hub
     cg.add(hub.register_device(device_var))
@@ -16,6 +16,7 @@ from . import (
     BTHomeDevice,
     BTHomeTextSensor,
     CONF_ENCRYPTION_KEY,
+    entity_storage,
     validate_encryption_key,
 )
 
@@ -59,17 +60,22 @@ async def to_code(config):
         key_array = cg.RawExpression(f"std::array<uint8_t, 16>{{{{{', '.join(str(b) for b in key_bytes)}}}}}")
         cg.add(device_var.set_encryption_key(key_array))
 
+    # Static table sized to the configured types (text 0x53 before raw 0x54 keeps it sorted)
+    configured = [t for t in [CONF_TEXT, CONF_RAW] if t in config]
+    if configured:
+        storage = entity_storage(config[CONF_ID], BTHomeTextSensor, len(configured), "text_sensors")
+        cg.add(device_var.set_text_sensor_storage(storage, len(configured)))
+
     # Create text sensors for each configured type
-    for sensor_type in [CONF_TEXT, CONF_RAW]:
-        if sensor_type in config:
-            sensor_config = config[sensor_type]
-            object_id = TEXT_SENSOR_TYPES[sensor_type]
+    for sensor_type in configured:
+        sensor_config = config[sensor_type]
+        object_id = TEXT_SENSOR_TYPES[sensor_type]
 
-            # Create the ESPHome text sensor
-            sens = await text_sensor.new_text_sensor(sensor_config)
+        # Create the ESPHome text sensor
+        sens = await text_sensor.new_text_sensor(sensor_config)
 
-            # Register text sensor with device (object_id, text_sensor*)
-            cg.add(device_var.add_text_sensor(object_id, sens))
+        # Register text sensor with device (object_id, text_sensor*)
+        cg.add(device_var.add_text_sensor(object_id, sens))
 
     # Register device with hub
     cg.add(hub.register_device(device_var))
@@ -0,0 +1,546 @@
+// Host benchmarks for the bthome broadcaster and bthome_receiver hot paths.
+//
+// Builds bthome.cpp, bthome_receiver.cpp and nimble_host.cpp for NimBLE against the stubs in
+// tests/stubs and prints one JSON report (make bench). Times are host CPU times: compare them
+// between commits on the same machine, not with the ESP32.
+
+#include "bench_util.h"
+#include "stand_in_controller.h"
+
+#include "components/bthome/bthome.h"
+#include "components/bthome_receiver/bthome_receiver.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+using namespace esphome;
+using bthome_bench::BenchReport;
+using bthome_bench::do_not_optimize;
+
+static const uint8_t KEY[16] = {0x23, 0x1d, 0x39, 0xc1, 0xd7, 0xcc, 0x1a, 0xb1,
+                                0xae, 0xe2, 0x24, 0xcd, 0x09, 0x6d, 0xb9, 0x32};
+static const uint8_t NODE_ADDRESS[6] = {0x01, 0x00, 0x00, 0xC1, 0xC4, 0xA4};  // Little-endian
+
+static uint64_t mac_of(const uint8_t address[6]) {
+  uint64_t mac = 0;
+  for (int i = 0; i < 6; i++) {
+    mac |= static_cast<uint64_t>(address[i]) << (i * 8);
+  }
+  return mac;
+}
+
+static void fail(const char *what) {
+  fprintf(stderr, "bench: %s\n", what);
+  exit(1);
+}
+
+// Protected hot paths, reached the way the component code itself reaches them
+class BenchBroadcaster : public bthome::BTHome {
+ public:
+  using bthome::BTHome::build_advertisement_data_;
+  const uint8_t *get_adv_data() const { return this->adv_data_; }
+  size_t get_adv_data_len() const { return this->adv_data_len_; }
+};
+
+class BenchHub : public bthome_receiver::BTHomeReceiverHub {
+ public:
+  using bthome_receiver::BTHomeReceiverHub::find_device_;
+};
+
+class BenchDevice : public bthome_receiver::BTHomeDevice {
+ public:
+  using bthome_receiver::BTHomeDevice::BTHomeDevice;
+  using bthome_receiver::BTHomeDevice::parse_measurements_;
+};
+
+// A weather station: temperature, humidity, battery, pressure and a door contact
+struct Station {
+  sensor::Sensor sensors[4];
+  binary_sensor::BinarySensor contact;
+  bthome_receiver::BTHomeSensor sensor_storage[4];
+  bthome_receiver::BTHomeBinarySensor binary_storage[1];
+
+  void attach(bthome_receiver::BTHomeDevice *device) {
+    device->set_sensor_storage(this->sensor_storage, 4);
+    device->set_binary_sensor_storage(this->binary_storage, 1);
+    device->add_sensor(0x02, 0, &this->sensors[0]);
+    device->add_sensor(0x03, 0, &this->sensors[1]);
+    device->add_sensor(0x01, 0, &this->sensors[2]);
+    device->add_sensor(0x04, 0, &this->sensors[3]);
+    device->add_binary_sensor(0x11, &this->contact);
+  }
+  uint32_t publishes() const {
+    uint32_t total = this->contact.get_publishes();
+    for (const auto &s : this->sensors) {
+      total += s.get_publishes();
+    }
+    return total;
+  }
+};
+
+// Measurement payload (after the device info byte) as the station sends it
+static size_t station_payload(uint8_t *out, uint8_t packet_id) {
+  const uint8_t payload[] = {0x00, packet_id,                // packet_id
+                             0x01, 0x5C,                     // battery 92 %
+                             0x02, 0xCA, 0x09,               // temperature 25.06 °C
+                             0x03, 0xBF, 0x13,               // humidity 50.55 %
+                             0x04, 0x13, 0x8A, 0x01,         // pressure 1008.83 hPa
+                             0x11, 0x01};                    // opening: open
+  memcpy(out, payload, sizeof(payload));
+  return sizeof(payload);
+}
+
+// Full advertising data: flags, then the BTHome service data
+static size_t station_advertisement(uint8_t *out, uint8_t packet_id) {
+  size_t pos = 0;
+  out[pos++] = 0x02;
+  out[pos++] = 0x01;
+  out[pos++] = 0x06;
+  size_t len_pos = pos++;
+  out[pos++] = bthome_codec::AD_TYPE_SERVICE_DATA_16;
+  out[pos++] = bthome_codec::SERVICE_UUID & 0xFF;
+  out[pos++] = bthome_codec::SERVICE_UUID >> 8;
+  out[pos++] = 0x40;  // Device info: unencrypted
+  pos += station_payload(out + pos, packet_id);
+  out[len_pos] = pos - len_pos - 1;
+  return pos;
+}
+
+// ============================================================================
+// AD walking: bthome_codec::find_service_data() on the reports a gateway sees
+// ============================================================================
+static void bench_ad_walk(BenchReport &report) {
+  uint8_t bthome[31];
+  size_t bthome_len = station_advertisement(bthome, 0);
+  // iBeacon: flags + manufacturer data, rejected
+  const uint8_t foreign[] = {0x02, 0x01, 0x06, 0x1A, 0xFF, 0x4C, 0x00, 0x02, 0x15, 0xE2, 0xC5, 0x6D, 0xB5, 0xDF,
+                             0xFB, 0x48, 0xD2, 0xB0, 0x60, 0xD0, 0xF5, 0xA7, 0x10, 0x96, 0xE0, 0x00, 0x01,
+                             0x00, 0x02, 0xC5};
+  // BTHome service data behind a complete local name
+  uint8_t named[31] = {0x02, 0x01, 0x06, 0x07, 0x09, 'S', 't', 'a', 't', 'i', 'o'};
+  size_t named_len = 11;
+  uint8_t service[20];
+  size_t service_len = station_payload(service, 0);
+  named[named_len++] = service_len + 4;
+  named[named_len++] = bthome_codec::AD_TYPE_SERVICE_DATA_16;
+  named[named_len++] = bthome_codec::SERVICE_UUID & 0xFF;
+  named[named_len++] = bthome_codec::SERVICE_UUID >> 8;
+  named[named_len++] = 0x40;
+  memcpy(named + named_len, service, service_len);
+  named_len += service_len;
+
+  struct Case {
+    const char *variant;
+    const uint8_t *data;
+    size_t len;
+    bool found;
+  } cases[] = {{"bthome", bthome, bthome_len, true},
+               {"bthome_after_name", named, named_len, true},
+               {"foreign", foreign, sizeof(foreign), false}};
+  for (const auto &c : cases) {
+    const uint8_t *service_data;
+    size_t service_data_len;
+    if (bthome_codec::find_service_data(c.data, c.len, service_data, service_data_len) != c.found) {
+      fail("find_service_data result");
+    }
+    report.run("ad_walk", c.variant, 0, 5000000, [&](uint32_t i) {
+      const uint8_t *data = c.data;
+      do_not_optimize(data);
+      bool found = bthome_codec::find_service_data(data, c.len, service_data, service_data_len);
+      do_not_optimize(found);
+    });
+  }
+}
+
+// ============================================================================
+// parse_measurements_(): decoding and publishing one plaintext payload
+// ============================================================================
+static void bench_parse_measurements(BenchReport &report) {
+  bthome_receiver::BTHomeReceiverHub hub;
+  BenchDevice device(&hub);
+  device.set_mac_address(0xA4C138000001ULL);
+  Station station;
+  station.attach(&device);
+
+  uint8_t payload[20];
+  size_t len = station_payload(payload, 0);
+  const uint32_t iterations = 2000000;
+  report.run("parse_measurements", "5_objects", 0, iterations, [&](uint32_t i) {
+    payload[1] = i;
+    device.parse_measurements_(payload, len);
+  });
+  if (station.publishes() == 0 || station.sensors[0].state != 25.06f) {
+    fail("parse_measurements did not publish");
+  }
+}
+
+// The all-in-one weather station of weather_display_t5_47.yaml: 10 sensors, sent as two
+// alternating packet formats. parse_advertisement() with and without a layout cache attached.
+static void bench_layout_cache(BenchReport &report) {
+  struct Entry {
+    uint8_t object_id;
+    uint8_t index;
+  };
+  static const Entry ENTITIES[] = {{0x45, 0}, {0x2E, 0}, {0x5F, 0}, {0x44, 0}, {0x44, 1},
+                                   {0x5E, 0}, {0x05, 0}, {0x01, 0}, {0x04, 0}, {0x08, 0}};
+  const size_t count = sizeof(ENTITIES) / sizeof(ENTITIES[0]);
+  // Service data: device_info, packet_id, then the objects
+  uint8_t wind[] = {0x40, 0x00, 0x00,
+                    0x45, 0xD7, 0x00,   // temperature_01 21.5 °C
+                    0x2E, 0x3C,         // humidity_uint8 60 %
+                    0x44, 0x2C, 0x01,   // speed 3.00 m/s
+                    0x44, 0xBC, 0x02,   // speed 7.00 m/s (gusts)
+                    0x5E, 0x30, 0x75};  // direction 300.00°
+  uint8_t ambient[] = {0x40, 0x00, 0x00,
+                       0x01, 0x5C,              // battery 92 %
+                       0x05, 0x40, 0x9C, 0x00,  // illuminance 400.00 lx
+                       0x04, 0x13, 0x8A, 0x01,  // pressure 1008.83 hPa
+                       0x08, 0x84, 0x03,        // dewpoint 9.00 °C
+                       0x5F, 0x7B, 0x00};       // precipitation 12.3 mm
+
+  for (bool cached : {false, true}) {
+    auto *device = new bthome_receiver::BTHomeDevice(new bthome_receiver::BTHomeReceiverHub());
+    device->set_mac_address(0xA4C138000002ULL);
+    auto *sensors = new sensor::Sensor[count];
+    device->set_sensor_storage(new bthome_receiver::BTHomeSensor[count], count);
+    for (size_t e = 0; e < count; e++) {
+      device->add_sensor(ENTITIES[e].object_id, ENTITIES[e].index, &sensors[e]);
+    }
+    auto *cache = new bthome_receiver::PacketLayoutCache();
+    if (cached) {
+      device->set_layout_cache(cache);
+    }
+    const uint32_t iterations = 2000000;
+    report.run("layout_cache", cached ? "on" : "off", 0, iterations, [&](uint32_t i) {
+      uint8_t *packet = i & 1 ? ambient : wind;
+      packet[2] = i >> 1;  // packet_id: a new packet every time, never a duplicate
+      device->parse_advertisement(packet, i & 1 ? sizeof(ambient) : sizeof(wind));
+    });
+    if (fabsf(sensors[4].state - 7.0f) > 0.001f || fabsf(sensors[2].state - 12.3f) > 0.001f ||
+        fabsf(sensors[9].state - 9.0f) > 0.001f) {
+      fail("layout_cache: wrong values published");
+    }
+    if (cached && cache->get_hits() == 0) {
+      fail("layout_cache: no packet decoded through a learned layout");
+    }
+  }
+}
+
+// ============================================================================
+// Encryption: build_advertisement_data_() and encrypted parse_advertisement()
+// ============================================================================
+static void setup_broadcaster(BenchBroadcaster &broadcaster, Station &station, bool encrypted) {
+  broadcaster.add_measurement(&station.sensors[0], 0x02, 2, true, 0.01f, false);
+  broadcaster.add_measurement(&station.sensors[1], 0x03, 2, false, 0.01f, false);
+  broadcaster.add_measurement(&station.sensors[2], 0x01, 1, false, 1.0f, false);
+  broadcaster.add_measurement(&station.sensors[3], 0x04, 3, false, 0.01f, false);
+  broadcaster.add_binary_measurement(&station.contact, 0x11, false);
+  station.sensors[0].publish_state(25.06f);
+  station.sensors[1].publish_state(50.55f);
+  station.sensors[2].publish_state(92.0f);
+  station.sensors[3].publish_state(1008.83f);
+  station.contact.publish_state(true);
+  if (encrypted) {
+    std::array<uint8_t, 16> key;
+    memcpy(key.data(), KEY, sizeof(KEY));
+    broadcaster.set_encryption_key(key);
+  }
+}
+
+// Build the broadcaster's next advertisement and return its BTHome service data
+static std::vector<uint8_t> next_service_data(BenchBroadcaster &broadcaster) {
+  broadcaster.build_advertisement_data_();
+  const uint8_t *service_data = nullptr;
+  size_t service_data_len = 0;
+  if (!bthome_codec::find_service_data(broadcaster.get_adv_data(), broadcaster.get_adv_data_len(), service_data,
+                                       service_data_len)) {
+    fail("broadcaster built no service data");
+  }
+  return std::vector<uint8_t>(service_data, service_data + service_data_len);
+}
+
+static void bench_build_advertisement(BenchReport &report) {
+  for (bool encrypted : {false, true}) {
+    BenchBroadcaster broadcaster;
+    Station station;
+    setup_broadcaster(broadcaster, station, encrypted);
+    report.run("build_advertisement", encrypted ? "encrypted" : "plain", 0, 1000000, [&](uint32_t i) {
+      broadcaster.build_advertisement_data_();
+      do_not_optimize(broadcaster.get_adv_data()[broadcaster.get_adv_data_len() - 1]);
+    });
+  }
+}
+
+static void bench_encrypted_decode(BenchReport &report) {
+  // Packets from the real broadcaster; each pass needs fresh counters, so build them all up front.
+  // The counter and MIC leave room for the four sensors only, so the contact never fits.
+  const uint32_t iterations = 50000;
+  BenchBroadcaster broadcaster;
+  Station source;
+  setup_broadcaster(broadcaster, source, true);
+  broadcaster.build_advertisement_data_();  // Counter 0 never passes the receiver's replay check
+  std::vector<std::vector<uint8_t>> packets;
+  for (uint32_t i = 0; i < iterations * (bthome_bench::BENCH_RUNS + 1); i++) {
+    packets.push_back(next_service_data(broadcaster));
+  }
+
+  bthome_receiver::BTHomeReceiverHub hub;
+  BenchDevice device(&hub);
+  device.set_mac_address(mac_of(NODE_ADDRESS));
+  std::array<uint8_t, 16> key;
+  memcpy(key.data(), KEY, sizeof(KEY));
+  device.set_encryption_key(key);
+  Station station;
+  station.attach(&device);
+
+  uint32_t offset = 0;
+  uint32_t accepted = 0;
+  report.run(
+      "encrypted_decode", "4_objects", 0, iterations,
+      [&](uint32_t i) {
+        const auto &packet = packets[offset + i];
+        accepted += device.parse_advertisement(packet.data(), packet.size());
+      },
+      [&](int run) { offset = run * iterations; });
+  if (accepted != packets.size() || station.sensors[0].state != 25.06f) {
+    fail("encrypted packets were rejected");
+  }
+}
+
+// One packet's decryption with the device's cached CCM context ("cached"), and with the
+// init + setkey + free per packet that the cache replaced ("rekey")
+static void bench_decrypt(BenchReport &report) {
+  BenchBroadcaster broadcaster;
+  Station source;
+  setup_broadcaster(broadcaster, source, true);
+  std::vector<std::vector<uint8_t>> packets;
+  for (int i = 0; i < 256; i++) {
+    packets.push_back(next_service_data(broadcaster));
+  }
+  uint8_t nonce_prefix[8];
+  memcpy(nonce_prefix, NODE_ADDRESS, 6);
+  nonce_prefix[6] = bthome_codec::SERVICE_UUID & 0xFF;
+  nonce_prefix[7] = bthome_codec::SERVICE_UUID >> 8;
+
+  auto decrypt = [&](mbedtls_ccm_context *ctx, uint32_t i) {
+    const auto &packet = packets[i % packets.size()];
+    size_t counter_offset = packet.size() - 8;
+    uint32_t counter = packet[counter_offset] | (packet[counter_offset + 1] << 8) |
+                       (packet[counter_offset + 2] << 16) | (packet[counter_offset + 3] << 24);
+    uint8_t plaintext[32];
+    size_t plaintext_len;
+    return bthome_receiver::decrypt_bthome_payload(ctx, nonce_prefix, packet.data() + 1, packet.size() - 1,
+                                                   packet[0], counter, plaintext, &plaintext_len);
+  };
+
+  mbedtls_ccm_context cached;
+  mbedtls_ccm_init(&cached);
+  mbedtls_ccm_setkey(&cached, MBEDTLS_CIPHER_ID_AES, KEY, 128);
+  uint32_t failures = 0;
+  const uint32_t iterations = 500000;
+  report.run("decrypt", "cached", 0, iterations, [&](uint32_t i) { failures += !decrypt(&cached, i); });
+  report.run("decrypt", "rekey", 0, iterations, [&](uint32_t i) {
+    mbedtls_ccm_context ctx;
+    mbedtls_ccm_init(&ctx);
+    mbedtls_ccm_setkey(&ctx, MBEDTLS_CIPHER_ID_AES, KEY, 128);
+    failures += !decrypt(&ctx, i);
+    mbedtls_ccm_free(&ctx);
+  });
+  mbedtls_ccm_free(&cached);
+  if (failures != 0) {
+    fail("decrypt_bthome_payload rejected broadcaster packets");
+  }
+}
+
+// ============================================================================
+// Hub ingest: GAP callback, queue and loop() for N registered devices
+// ============================================================================
+struct IngestNode {
+  bthome_receiver::BTHomeReceiverHub *hub;
+  Station *stations;
+  std::vector<std::array<uint8_t, 6>> addresses;  // Little-endian, one per registered device
+};
+
+// A scanning hub with device_count registered stations. Components live for the whole run, like
+// on the node; the shared host keeps pointers to them.
+static IngestNode make_ingest_node(uint32_t device_count) {
+  bthome_host::controller_reset_state();
+  IngestNode node{new bthome_receiver::BTHomeReceiverHub(), new Station[device_count], {}};
+  node.addresses.resize(device_count);
+  for (uint32_t d = 0; d < device_count; d++) {
+    node.addresses[d] = {static_cast<uint8_t>(d), static_cast<uint8_t>(d >> 8), 0x38, 0xC1, 0xA4, 0xA4};
+    auto *device = new bthome_receiver::BTHomeDevice(node.hub);
+    device->set_mac_address(mac_of(node.addresses[d].data()));
+    node.stations[d].attach(device);
+    node.hub->register_device(device);
+  }
+  node.hub->setup();
+  node.hub->loop();  // Starts the host
+  bthome_host::controller_sync();
+  node.hub->loop();  // Sees the sync and starts scanning
+  if (!bthome_host::controller_scanning()) {
+    fail("hub did not start scanning");
+  }
+  return node;
+}
+
+// Reports round-robin over the devices, each with a new packet_id; loop() drains a batch
+static void bench_hub_ingest(BenchReport &report, uint32_t device_count) {
+  IngestNode node = make_ingest_node(device_count);
+  uint8_t adv[31];
+  size_t adv_len = station_advertisement(adv, 0);
+  const uint32_t batch = bthome_receiver::ADV_QUEUE_LOOP_BUDGET;
+  const uint32_t iterations = 400000;
+  uint32_t received_before = node.hub->get_reports_received();
+  report.run("hub_ingest", "plain", device_count, iterations, [&](uint32_t i) {
+    uint32_t d = i % device_count;
+    adv[9] = static_cast<uint8_t>(i / device_count);  // packet_id
+    bthome_host::controller_advertise(node.addresses[d].data(), BLE_ADDR_PUBLIC, adv, adv_len);
+    if (i % batch == batch - 1) {
+      node.hub->loop();
+    }
+  });
+  node.hub->loop();
+  uint32_t received = node.hub->get_reports_received() - received_before;
+  if (received != iterations * (bthome_bench::BENCH_RUNS + 1) || node.hub->get_queue_drops() != 0) {
+    fail("hub dropped reports");
+  }
+  if (node.stations[device_count - 1].publishes() == 0) {
+    fail("hub did not publish");
+  }
+}
+
+// A synthetic stand-in for a capture from a busy site (no real capture is checked in): out of
+// every 20 reports, 14 are phones, beacons and TVs, 4 come from registered BTHome devices and 2
+// from BTHome senders nobody configured. "foreign_only" is the prefilter's reject path alone.
+static void bench_hub_ingest_mix(BenchReport &report) {
+  const uint32_t device_count = 50;
+  IngestNode node = make_ingest_node(device_count);
+
+  struct Report {
+    std::array<uint8_t, 6> address;
+    std::vector<uint8_t> data;
+    bool bthome;
+  };
+  const std::vector<std::vector<uint8_t>> foreign = {
+      // iBeacon
+      {0x02, 0x01, 0x06, 0x1A, 0xFF, 0x4C, 0x00, 0x02, 0x15, 0xE2, 0xC5, 0x6D, 0xB5, 0xDF, 0xFB, 0x48, 0xD2,
+       0xB0, 0x60, 0xD0, 0xF5, 0xA7, 0x10, 0x96, 0xE0, 0x00, 0x01, 0x00, 0x02, 0xC5},
+      // Apple Nearby Info
+      {0x02, 0x01, 0x1A, 0x0A, 0xFF, 0x4C, 0x00, 0x10, 0x05, 0x01, 0x18, 0x3D, 0x71, 0x2A},
+      // Microsoft Swift Pair / CDP
+      {0x1E, 0xFF, 0x06, 0x00, 0x01, 0x09, 0x20, 0x02, 0x6B, 0x4F, 0x3C, 0x8E, 0x31, 0x5A, 0x70, 0x96,
+       0x14, 0xC4, 0x2B, 0x5F, 0x0A, 0x7E, 0x93, 0x12, 0xD8, 0x40, 0x1B, 0x66, 0x05, 0xA9, 0xE3},
+      // Eddystone-URL
+      {0x03, 0x03, 0xAA, 0xFE, 0x11, 0x16, 0xAA, 0xFE, 0x10, 0x00, 0x03, 'e', 'x', 'a', 'm', 'p', 'l', 'e',
+       0x07},
+      // Xiaomi MiBeacon service data
+      {0x02, 0x01, 0x06, 0x0F, 0x16, 0x95, 0xFE, 0x50, 0x20, 0xAA, 0x01, 0x3B, 0x1F, 0x52, 0x38, 0xC1,
+       0xA4, 0x08, 0x0D},
+      // TV: name and a 16-bit service list
+      {0x02, 0x01, 0x06, 0x05, 0x09, 'L', 'G', 'T', 'V', 0x03, 0x03, 0x0F, 0x18},
+  };
+  uint8_t bthome[31];
+  size_t bthome_len = station_advertisement(bthome, 0);
+
+  std::vector<Report> mix, foreign_only;
+  for (uint32_t k = 0; k < 20 * device_count / 4; k++) {
+    uint32_t slot = k % 20;
+    std::array<uint8_t, 6> stranger = {static_cast<uint8_t>(k), static_cast<uint8_t>(k >> 8), 0x5E, 0x1B, 0x2F,
+                                       0x7C};
+    if (slot < 14) {
+      mix.push_back({stranger, foreign[k % foreign.size()], false});
+      foreign_only.push_back(mix.back());
+    } else if (slot < 18) {
+      mix.push_back({node.addresses[(k / 20 * 4 + slot - 14) % device_count],
+                     std::vector<uint8_t>(bthome, bthome + bthome_len), true});
+    } else {
+      mix.push_back({stranger, std::vector<uint8_t>(bthome, bthome + bthome_len), true});
+    }
+  }
+
+  const uint32_t batch = bthome_receiver::ADV_QUEUE_LOOP_BUDGET;
+  const uint32_t iterations = 400000;
+  for (auto *reports : {&mix, &foreign_only}) {
+    uint32_t received_before = node.hub->get_reports_received();
+    uint32_t bthome_sent = 0;
+    report.run("hub_ingest", reports == &mix ? "mixed_synthetic" : "foreign_only", device_count, iterations,
+               [&](uint32_t i) {
+                 Report &r = (*reports)[i % reports->size()];
+                 if (r.bthome) {
+                   r.data[9] = static_cast<uint8_t>(i / reports->size());  // packet_id
+                   bthome_sent++;
+                 }
+                 bthome_host::controller_advertise(r.address.data(), BLE_ADDR_PUBLIC, r.data.data(), r.data.size());
+                 if (i % batch == batch - 1) {
+                   node.hub->loop();
+                 }
+               });
+    node.hub->loop();
+    if (node.hub->get_reports_received() - received_before != bthome_sent || node.hub->get_queue_drops() != 0) {
+      fail("hub queued foreign reports or dropped BTHome ones");
+    }
+  }
+}
+
+// ============================================================================
+// Device lookup: find_device_() for registered MACs (hit) and unconfigured senders (miss).
+// "linear" is the scan over devices_ that the MAC index replaced, kept as the baseline.
+// ============================================================================
+static void bench_device_lookup(BenchReport &report, uint32_t device_count) {
+  // Never freed, like the components in bench_hub_ingest()
+  auto &hub = *new BenchHub();
+  std::vector<bthome_receiver::BTHomeDevice *> devices;
+  std::vector<uint64_t> registered, unconfigured;
+  for (uint32_t d = 0; d < device_count; d++) {
+    registered.push_back(0xA4C138000000ULL | d);
+    unconfigured.push_back(0x7C2F80000000ULL | d);
+    auto *device = new bthome_receiver::BTHomeDevice(&hub);
+    device->set_mac_address(registered.back());
+    hub.register_device(device);
+    devices.push_back(device);
+  }
+  hub.setup();
+  if (hub.find_device_(registered[device_count - 1]) != devices[device_count - 1] ||
+      hub.find_device_(unconfigured[0]) != nullptr) {
+    fail("find_device_ result");
+  }
+
+  auto linear = [&](uint64_t mac) -> bthome_receiver::BTHomeDevice * {
+    for (auto *device : devices) {
+      if (device->get_mac_address() == mac) {
+        return device;
+      }
+    }
+    return nullptr;
+  };
+  const uint32_t iterations = 2000000;
+  for (bool hit : {true, false}) {
+    const std::vector<uint64_t> &macs = hit ? registered : unconfigured;
+    report.run("device_lookup", hit ? "index_hit" : "index_miss", device_count, iterations,
+               [&](uint32_t i) { do_not_optimize(hub.find_device_(macs[i % device_count])); });
+    report.run("device_lookup", hit ? "linear_hit" : "linear_miss", device_count, iterations,
+               [&](uint32_t i) { do_not_optimize(linear(macs[i % device_count])); });
+  }
+}
+
+int main() {
+  BenchReport report("bthome");
+  bench_ad_walk(report);
+  bench_parse_measurements(report);
+  bench_layout_cache(report);
+  bench_build_advertisement(report);
+  bench_decrypt(report);
+  bench_encrypted_decode(report);
+  for (uint32_t devices : {1u, 50u, 500u}) {
+    bench_device_lookup(report, devices);
+  }
+  for (uint32_t devices : {1u, 50u, 500u}) {
+    bench_hub_ingest(report, devices);
+  }
+  bench_hub_ingest_mix(report);
+  report.print(stdout);
+  return 0;
+}
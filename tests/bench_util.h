@@ -0,0 +1,81 @@
+#pragma once
+// Host benchmark helpers: timed loops and the JSON report printed by the bench targets.
+//
+// Every case runs a warm-up pass, then BENCH_RUNS timed passes; the report keeps the median
+// ns/op, so a single preempted pass does not move the result.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace bthome_bench {
+
+static const int BENCH_RUNS = 7;
+
+// Keep a value alive so the compiler cannot drop the work that produced it
+template<typename T> inline void do_not_optimize(const T &value) { asm volatile("" : : "r,m"(value) : "memory"); }
+
+struct BenchResult {
+  std::string name;
+  std::string variant;
+  uint32_t devices;  // 0 = not a per-device-count case
+  uint32_t iterations;
+  double ns_per_op;
+};
+
+class BenchReport {
+ public:
+  explicit BenchReport(const char *suite) : suite_(suite) {}
+
+  // Time body(i) for i in [0, iterations) and record the median ns per call. setup(run), if
+  // given, runs untimed before every pass, e.g. to reset state the body consumes.
+  template<typename Body, typename Setup>
+  double run(const char *name, const char *variant, uint32_t devices, uint32_t iterations, Body &&body,
+             Setup &&setup) {
+    std::vector<double> samples;
+    for (int run = -1; run < BENCH_RUNS; run++) {
+      setup(run + 1);
+      auto start = std::chrono::steady_clock::now();
+      for (uint32_t i = 0; i < iterations; i++) {
+        body(i);
+      }
+      auto elapsed = std::chrono::steady_clock::now() - start;
+      if (run >= 0) {  // run -1 is the warm-up pass
+        samples.push_back(std::chrono::duration<double, std::nano>(elapsed).count() / iterations);
+      }
+    }
+    std::sort(samples.begin(), samples.end());
+    double median = samples[samples.size() / 2];
+    this->results_.push_back({name, variant, devices, iterations, median});
+    return median;
+  }
+
+  template<typename Body> double run(const char *name, const char *variant, uint32_t devices, uint32_t iterations,
+                                     Body &&body) {
+    return this->run(name, variant, devices, iterations, body, [](int) {});
+  }
+
+  void print(FILE *out) const {
+    fprintf(out, "{\n  \"suite\": \"%s\",\n  \"compiler\": \"%s\",\n  \"runs\": %d,\n  \"results\": [\n",
+            this->suite_, __VERSION__, BENCH_RUNS);
+    for (size_t i = 0; i < this->results_.size(); i++) {
+      const BenchResult &r = this->results_[i];
+      fprintf(out, "    {\"name\": \"%s\", \"variant\": \"%s\", ", r.name.c_str(), r.variant.c_str());
+      if (r.devices > 0) {
+        fprintf(out, "\"devices\": %u, ", r.devices);
+      }
+      fprintf(out, "\"iterations\": %u, \"ns_per_op\": %.1f}%s\n", r.iterations, r.ns_per_op,
+              i + 1 < this->results_.size() ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+  }
+
+ protected:
+  const char *suite_;
+  std::vector<BenchResult> results_;
+};
+
+}  // namespace bthome_bench
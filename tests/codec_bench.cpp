@@ -0,0 +1,70 @@
+// Host benchmarks for bthome_codec: object lookup, encoding and decoding (make bench-codec).
+// Header-only, so this builds without the component stubs.
+
+#include "bench_util.h"
+
+#include "components/bthome_codec/bthome_codec.h"
+
+#include <cstring>
+#include <map>
+
+using namespace esphome::bthome_codec;
+using bthome_bench::BenchReport;
+using bthome_bench::do_not_optimize;
+
+static const size_t OBJECT_TYPE_COUNT = sizeof(OBJECT_TYPE_ENTRIES) / sizeof(OBJECT_TYPE_ENTRIES[0]);
+
+// Object IDs as they arrive: the defined IDs, round-robin. "std_map" is the heap-built
+// std::map lookup that the constexpr table replaced, kept as the baseline.
+static void bench_object_lookup(BenchReport &report) {
+  uint8_t ids[OBJECT_TYPE_COUNT];
+  std::map<uint8_t, ObjectTypeInfo> map;
+  for (size_t i = 0; i < OBJECT_TYPE_COUNT; i++) {
+    ids[i] = OBJECT_TYPE_ENTRIES[i].object_id;
+    map[ids[i]] = OBJECT_TYPE_ENTRIES[i].info;
+  }
+  report.run("object_lookup", "table", 0, 10000000, [&](uint32_t i) {
+    const ObjectTypeInfo &info = get_object_type(ids[i % OBJECT_TYPE_COUNT]);
+    do_not_optimize(info.data_bytes);
+  });
+  report.run("object_lookup", "std_map", 0, 10000000, [&](uint32_t i) {
+    auto it = map.find(ids[i % OBJECT_TYPE_COUNT]);
+    do_not_optimize(it->second.data_bytes);
+  });
+}
+
+static void bench_encode(BenchReport &report) {
+  uint8_t buf[8];
+  report.run("encode_value", "temperature", 0, 10000000, [&](uint32_t i) {
+    float value = 20.0f + (i & 0xFF) * 0.01f;
+    do_not_optimize(value);
+    size_t len = encode_value(buf, sizeof(buf), 0x02, value, 2, true, 0.01f);
+    do_not_optimize(buf[len - 1]);
+  });
+}
+
+// A weather station payload: packet_id, battery, temperature, humidity, pressure, opening
+static void bench_decode(BenchReport &report) {
+  const uint8_t payload[] = {0x00, 0x2A, 0x01, 0x5C, 0x02, 0xCA, 0x09, 0x03,
+                             0xBF, 0x13, 0x04, 0x13, 0x8A, 0x01, 0x11, 0x01};
+  report.run("decode_payload", "6_objects", 0, 5000000, [&](uint32_t i) {
+    const uint8_t *data = payload;
+    do_not_optimize(data);
+    size_t pos = 0;
+    DecodedObject obj;
+    int64_t sum = 0;
+    while (next_object(data, sizeof(payload), pos, obj) == DECODE_OK) {
+      sum += decode_raw(obj);
+    }
+    do_not_optimize(sum);
+  });
+}
+
+int main() {
+  BenchReport report("bthome_codec");
+  bench_object_lookup(report);
+  bench_encode(report);
+  bench_decode(report);
+  report.print(stdout);
+  return 0;
+}
@@ -0,0 +1,223 @@
+// Round-trip tests for bthome_codec: every object type in OBJECT_TYPE_ENTRIES is encoded and
+// decoded back through next_object() and decode_raw(), including sign extension and the clamp
+// at the edges of each integer width (make test).
+
+#include "test_util.h"
+
+#include "components/bthome_codec/bthome_codec.h"
+
+#include <cinttypes>
+#include <cstring>
+
+using namespace esphome::bthome_codec;
+
+// Largest and smallest raw integer an object of this type can carry
+static int64_t raw_max(const ObjectTypeInfo &info) {
+  return info.is_signed ? (int64_t(1) << (info.data_bytes * 8 - 1)) - 1 : (int64_t(1) << (info.data_bytes * 8)) - 1;
+}
+static int64_t raw_min(const ObjectTypeInfo &info) { return info.is_signed ? -raw_max(info) - 1 : 0; }
+
+// Encode value as object_id, decode it back and return the raw integer (INT64_MIN on failure)
+static int64_t round_trip(uint8_t object_id, const ObjectTypeInfo &info, float value) {
+  uint8_t buf[8];
+  size_t written = encode_value(buf, sizeof(buf), object_id, value, info.data_bytes, info.is_signed, info.factor);
+  if (written != 1u + info.data_bytes) {
+    return INT64_MIN;
+  }
+  size_t pos = 0;
+  DecodedObject obj;
+  if (next_object(buf, written, pos, obj) != DECODE_OK || pos != written || obj.object_id != object_id ||
+      obj.payload_len != info.data_bytes) {
+    return INT64_MIN;
+  }
+  return decode_raw(obj);
+}
+
+static void test_table() {
+  for (const auto &entry : OBJECT_TYPE_ENTRIES) {
+    const ObjectTypeInfo &info = get_object_type(entry.object_id);
+    CHECK(info.kind == entry.info.kind && info.data_bytes == entry.info.data_bytes &&
+              info.is_signed == entry.info.is_signed && info.factor == entry.info.factor &&
+              strcmp(info.name, entry.info.name) == 0,
+          "0x%02X: table entry differs from OBJECT_TYPE_ENTRIES", entry.object_id);
+    CHECK(entry.info.kind != OBJECT_KIND_UNKNOWN, "0x%02X: entry has no kind", entry.object_id);
+  }
+  CHECK(get_object_type(0xFF).kind == OBJECT_KIND_UNKNOWN, "0xFF is defined");
+}
+
+static void test_sensors() {
+  for (const auto &entry : OBJECT_TYPE_ENTRIES) {
+    const ObjectTypeInfo &info = entry.info;
+    if (info.kind != OBJECT_KIND_SENSOR) {
+      continue;
+    }
+    const uint8_t id = entry.object_id;
+    int64_t max = raw_max(info);
+    int64_t min = raw_min(info);
+
+    // Exact round trips; beyond 16 bits a float no longer holds raw * factor exactly
+    const int64_t raws[] = {0, 1, 100, 12345, max, min, -1, -12345, min + 1, max - 1};
+    for (int64_t raw : raws) {
+      if (raw > max || raw < min || raw > 65535 || raw < -65536) {
+        continue;
+      }
+      float value = static_cast<float>(static_cast<double>(raw) * info.factor);
+      int64_t got = round_trip(id, info, value);
+      CHECK(got == raw, "%s (0x%02X): %g encoded as raw %" PRId64 ", decoded %" PRId64, info.name, id, value, raw,
+            got);
+    }
+
+    // Values outside the width clamp to its edges instead of wrapping
+    float above = static_cast<float>(static_cast<double>(max) * info.factor * 4.0 + 1000.0);
+    float below = static_cast<float>(static_cast<double>(min) * info.factor * 4.0 - 1000.0);
+    CHECK(round_trip(id, info, above) == max, "%s (0x%02X): %g did not clamp to %" PRId64, info.name, id, above, max);
+    CHECK(round_trip(id, info, below) == min, "%s (0x%02X): %g did not clamp to %" PRId64, info.name, id, below, min);
+
+    // Too little room: nothing is written
+    uint8_t buf[8] = {0};
+    CHECK(encode_value(buf, info.data_bytes, id, 1.0f, info.data_bytes, info.is_signed, info.factor) == 0,
+          "%s (0x%02X): encoded into a short buffer", info.name, id);
+
+    // One payload byte short of a whole object
+    size_t len = encode_value(buf, sizeof(buf), id, 0.0f, info.data_bytes, info.is_signed, info.factor);
+    size_t pos = 0;
+    DecodedObject obj;
+    CHECK(next_object(buf, len - 1, pos, obj) == DECODE_TRUNCATED && obj.object_id == id,
+          "%s (0x%02X): truncated object not reported", info.name, id);
+  }
+}
+
+static void test_sign_extension() {
+  struct Case {
+    uint8_t bytes[4];
+    uint8_t width;
+    bool is_signed;
+    int64_t expected;
+  } cases[] = {
+      {{0x7F}, 1, true, 127},
+      {{0x80}, 1, true, -128},
+      {{0xFF}, 1, true, -1},
+      {{0xFF}, 1, false, 255},
+      {{0xFF, 0x7F}, 2, true, 32767},
+      {{0x00, 0x80}, 2, true, -32768},
+      {{0xFF, 0xFF}, 2, true, -1},
+      {{0xFF, 0xFF}, 2, false, 65535},
+      {{0xFF, 0xFF, 0x7F}, 3, true, 8388607},
+      {{0x00, 0x00, 0x80}, 3, true, -8388608},
+      {{0xFF, 0xFF, 0xFF}, 3, true, -1},
+      {{0xFF, 0xFF, 0xFF}, 3, false, 16777215},
+      {{0x00, 0x00, 0x00, 0x80}, 4, true, INT32_MIN},
+      {{0xFF, 0xFF, 0xFF, 0xFF}, 4, true, -1},
+      {{0xFF, 0xFF, 0xFF, 0x7F}, 4, true, INT32_MAX},
+      {{0xFF, 0xFF, 0xFF, 0xFF}, 4, false, 4294967295},
+  };
+  for (const auto &c : cases) {
+    int64_t got = read_le(c.bytes, c.width, c.is_signed);
+    CHECK(got == c.expected, "read_le width %u %s: expected %" PRId64 ", got %" PRId64, c.width,
+          c.is_signed ? "signed" : "unsigned", c.expected, got);
+  }
+
+  // The signed types in the table, through the full decode path
+  const uint8_t temperature[] = {0x02, 0x18, 0xFC};  // -10.00 °C
+  size_t pos = 0;
+  DecodedObject obj;
+  CHECK(next_object(temperature, sizeof(temperature), pos, obj) == DECODE_OK && decode_raw(obj) == -1000,
+        "temperature -10.00 did not decode to raw -1000");
+  const uint8_t power[] = {0x5C, 0x9C, 0xFF, 0xFF, 0xFF};  // power_sint32 -1.00 W
+  pos = 0;
+  CHECK(next_object(power, sizeof(power), pos, obj) == DECODE_OK && decode_raw(obj) == -100,
+        "power_sint32 -1.00 did not decode to raw -100");
+}
+
+static void test_binary_and_events() {
+  for (const auto &entry : OBJECT_TYPE_ENTRIES) {
+    const ObjectTypeInfo &info = entry.info;
+    if (info.kind == OBJECT_KIND_BINARY_SENSOR) {
+      for (bool state : {false, true}) {
+        uint8_t buf[2];
+        size_t len = encode_binary(buf, sizeof(buf), entry.object_id, state);
+        size_t pos = 0;
+        DecodedObject obj;
+        CHECK(len == 2 && next_object(buf, len, pos, obj) == DECODE_OK && pos == 2 && decode_raw(obj) == state,
+              "%s (0x%02X): %d did not round-trip", info.name, entry.object_id, state);
+      }
+      uint8_t buf[1];
+      CHECK(encode_binary(buf, sizeof(buf), entry.object_id, true) == 0, "%s: encoded into a short buffer",
+            info.name);
+    } else if (info.kind == OBJECT_KIND_EVENT) {
+      // Events are only ever received; the payload is the event code
+      const uint8_t data[] = {entry.object_id, 0xFE};
+      size_t pos = 0;
+      DecodedObject obj;
+      CHECK(next_object(data, sizeof(data), pos, obj) == DECODE_OK && pos == 2 && obj.payload_len == 1,
+            "%s (0x%02X): event not located", info.name, entry.object_id);
+      CHECK(decode_raw(obj) == (info.is_signed ? -2 : 0xFE), "%s (0x%02X): event code %" PRId64, info.name,
+            entry.object_id, decode_raw(obj));
+    }
+  }
+}
+
+static void test_variable_length() {
+  for (uint8_t id : {OBJECT_ID_TEXT, OBJECT_ID_RAW}) {
+    const uint8_t data[] = {id, 0x03, 'a', 'b', 'c', 0x01, 0x5C};
+    size_t pos = 0;
+    DecodedObject obj;
+    CHECK(next_object(data, sizeof(data), pos, obj) == DECODE_OK && obj.payload_len == 3 &&
+              memcmp(obj.payload, "abc", 3) == 0 && pos == 5,
+          "0x%02X: variable-length payload not located", id);
+    CHECK(next_object(data, sizeof(data), pos, obj) == DECODE_OK && obj.object_id == 0x01 && decode_raw(obj) == 92,
+          "0x%02X: object after the variable-length payload not decoded", id);
+    CHECK(next_object(data, sizeof(data), pos, obj) == DECODE_END, "0x%02X: data did not end", id);
+
+    pos = 0;
+    CHECK(next_object(data, 4, pos, obj) == DECODE_TRUNCATED, "0x%02X: short payload not reported", id);
+    pos = 0;
+    CHECK(next_object(data, 1, pos, obj) == DECODE_TRUNCATED, "0x%02X: missing length byte not reported", id);
+  }
+}
+
+// Every sensor and binary type back to back in one payload, as a receiver walks it
+static void test_sequence() {
+  uint8_t buf[512];
+  size_t len = 0;
+  for (const auto &entry : OBJECT_TYPE_ENTRIES) {
+    const ObjectTypeInfo &info = entry.info;
+    if (info.kind == OBJECT_KIND_SENSOR) {
+      len += encode_value(buf + len, sizeof(buf) - len, entry.object_id, info.factor * 7, info.data_bytes,
+                          info.is_signed, info.factor);
+    } else if (info.kind == OBJECT_KIND_BINARY_SENSOR) {
+      len += encode_binary(buf + len, sizeof(buf) - len, entry.object_id, true);
+    }
+  }
+
+  size_t pos = 0;
+  DecodedObject obj;
+  for (const auto &entry : OBJECT_TYPE_ENTRIES) {
+    const ObjectTypeInfo &info = entry.info;
+    if (info.kind != OBJECT_KIND_SENSOR && info.kind != OBJECT_KIND_BINARY_SENSOR) {
+      continue;
+    }
+    DecodeStatus status = next_object(buf, len, pos, obj);
+    int64_t expected = info.kind == OBJECT_KIND_SENSOR ? 7 : 1;
+    CHECK(status == DECODE_OK && obj.object_id == entry.object_id && decode_raw(obj) == expected,
+          "%s (0x%02X): sequence decode out of step", info.name, entry.object_id);
+  }
+  CHECK(next_object(buf, len, pos, obj) == DECODE_END, "sequence did not end after the last object");
+
+  // An undefined object ID stops parsing: its size is unknown
+  const uint8_t unknown[] = {0x01, 0x5C, 0xFF, 0x00};
+  pos = 0;
+  next_object(unknown, sizeof(unknown), pos, obj);
+  CHECK(next_object(unknown, sizeof(unknown), pos, obj) == DECODE_UNKNOWN_OBJECT && obj.object_id == 0xFF,
+        "undefined object ID not reported");
+}
+
+int main() {
+  test_table();
+  test_sensors();
+  test_sign_extension();
+  test_binary_and_events();
+  test_variable_length();
+  test_sequence();
+  return bthome_test::finish("codec_roundtrip");
+}
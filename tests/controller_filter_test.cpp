@@ -0,0 +1,215 @@
+// Controller-side filtering in bthome_receiver on NimBLE, against the stand-in controller
+// (make test): the accept list is programmed from loop() once the host syncs, reports from
+// unlisted senders never reach the host, a list the controller cannot hold falls back to
+// unfiltered scanning without retrying, and a host reset re-programs the list.
+
+#include "test_util.h"
+#include "stand_in_controller.h"
+
+#include "components/bthome_receiver/bthome_receiver.h"
+
+#include <array>
+#include <cstring>
+#include <vector>
+
+using namespace esphome;
+using bthome_receiver::BTHomeDevice;
+using bthome_receiver::BTHomeReceiverHub;
+
+using Address = std::array<uint8_t, 6>;  // Little-endian, as the controller reports it
+
+static Address address_of(uint8_t n) { return {n, 0x00, 0x38, 0xC1, 0xA4, 0xA4}; }
+
+static uint64_t mac_of(const Address &address) {
+  uint64_t mac = 0;
+  for (int i = 0; i < 6; i++) {
+    mac |= static_cast<uint64_t>(address[i]) << (i * 8);
+  }
+  return mac;
+}
+
+// Flags + BTHome service data: packet_id, then temperature
+static size_t advertisement(uint8_t *out, uint8_t packet_id) {
+  const uint8_t adv[] = {0x02, 0x01, 0x06, 0x09, bthome_codec::AD_TYPE_SERVICE_DATA_16, 0xD2, 0xFC, 0x40, 0x00,
+                         packet_id, 0x02, 0xCA, 0x09};
+  memcpy(out, adv, sizeof(adv));
+  return sizeof(adv);
+}
+
+struct Node {
+  BTHomeReceiverHub *hub;
+  std::vector<Address> listed;  // Registered devices
+};
+
+// A hub with device_count registered devices, set up and with the host started, not yet synced.
+// Components are never freed: the shared NimBLE host keeps pointers to them.
+static Node make_node(size_t device_count, bool controller_filter) {
+  bthome_host::controller_reset_state();
+  Node node{new BTHomeReceiverHub(), {}};
+  node.hub->set_controller_filter(controller_filter);
+  for (size_t d = 0; d < device_count; d++) {
+    node.listed.push_back(address_of(d));
+    auto *device = new BTHomeDevice(node.hub);
+    device->set_mac_address(mac_of(node.listed.back()));
+    node.hub->register_device(device);
+  }
+  node.hub->setup();
+  node.hub->loop();  // Starts the host
+  return node;
+}
+
+static void sync(Node &node) {
+  bthome_host::controller_sync();
+  node.hub->loop();
+}
+
+static void test_accept_list_programmed_from_loop() {
+  Node node = make_node(3, true);
+  bthome_host::controller_sync();
+  // The sync callback runs on the host task; it only posts a request
+  CHECK(bthome_host::controller_accept_list_writes() == 0, "accept list written from the sync callback");
+  CHECK(!bthome_host::controller_scanning(), "scan started from the sync callback");
+
+  node.hub->loop();
+  CHECK(bthome_host::controller_scanning(), "loop() did not start scanning after sync");
+  CHECK(bthome_host::controller_accept_list_size() == 6, "accept list holds %zu entries, expected 6",
+        bthome_host::controller_accept_list_size());
+  CHECK(bthome_host::controller_scan_params().filter_policy == BLE_HCI_SCAN_FILT_USE_WL,
+        "scan does not use the accept list");
+  CHECK(bthome_host::controller_scan_params().filter_duplicates == 1, "scan does not filter duplicates");
+}
+
+static void test_unlisted_senders_filtered() {
+  Node node = make_node(2, true);
+  sync(node);
+  uint8_t adv[31];
+  size_t len = advertisement(adv, 1);
+  Address stranger = address_of(0x80);
+
+  CHECK(bthome_host::controller_advertise(node.listed[0].data(), BLE_ADDR_PUBLIC, adv, len),
+        "listed public address filtered");
+  CHECK(bthome_host::controller_advertise(node.listed[1].data(), BLE_ADDR_RANDOM, adv, len),
+        "listed random address filtered");
+  CHECK(!bthome_host::controller_advertise(stranger.data(), BLE_ADDR_PUBLIC, adv, len),
+        "unlisted address reached the host");
+  CHECK(!bthome_host::controller_advertise(node.listed[0].data(), BLE_ADDR_PUBLIC, adv, len),
+        "retransmission reached the host");
+  node.hub->loop();
+  CHECK(node.hub->get_reports_received() == 2, "%u reports processed, expected 2", node.hub->get_reports_received());
+}
+
+// The same traffic with and without the mode: listed and unlisted BTHome senders, each packet
+// retransmitted a few times, as a busy site looks to the radio
+static uint32_t reports_processed(bool controller_filter) {
+  const size_t listed = 4, unlisted = 12, packets = 20, retransmits = 3;
+  Node node = make_node(listed, controller_filter);
+  sync(node);
+  uint8_t adv[31];
+  for (size_t p = 0; p < packets; p++) {
+    size_t len = advertisement(adv, p);
+    for (size_t d = 0; d < listed + unlisted; d++) {
+      Address sender = address_of(d);
+      for (size_t r = 0; r < retransmits; r++) {
+        bthome_host::controller_advertise(sender.data(), BLE_ADDR_PUBLIC, adv, len);
+      }
+      node.hub->loop();  // Drain well inside the queue, so no report is dropped
+    }
+  }
+  CHECK(node.hub->get_queue_drops() == 0, "%u reports dropped at the queue", node.hub->get_queue_drops());
+  return node.hub->get_reports_received();
+}
+
+static void test_reports_with_and_without_filter() {
+  uint32_t unfiltered = reports_processed(false);
+  uint32_t filtered = reports_processed(true);
+  CHECK(unfiltered == 16 * 20 * 3, "without the filter %u reports processed, expected %u", unfiltered, 16 * 20 * 3);
+  CHECK(filtered == 4 * 20, "with the filter %u reports processed, expected %u", filtered, 4 * 20);
+  printf("controller_filter: %u reports reach process_nimble_advertisement() without the filter, %u with it\n",
+         unfiltered, filtered);
+}
+
+static void test_fallback_when_list_does_not_fit() {
+  Node node = make_node(3, true);
+  bthome_host::controller_set_accept_list_capacity(4);  // 3 devices need 6 entries
+  sync(node);
+  CHECK(bthome_host::controller_scanning(), "no scan after the accept list failed");
+  CHECK(bthome_host::controller_scan_params().filter_policy == BLE_HCI_SCAN_FILT_NO_WL,
+        "scan uses an accept list the controller rejected");
+  CHECK(bthome_host::controller_scan_params().filter_duplicates == 1, "fallback dropped the duplicate filter");
+
+  uint8_t adv[31];
+  size_t len = advertisement(adv, 1);
+  Address stranger = address_of(0x80);
+  CHECK(bthome_host::controller_advertise(stranger.data(), BLE_ADDR_PUBLIC, adv, len),
+        "unfiltered scan dropped an unlisted sender");
+
+  // A reset does not make the list fit; it is not tried again
+  uint32_t writes = bthome_host::controller_accept_list_writes();
+  bthome_host::controller_reset(0);
+  node.hub->loop();
+  sync(node);
+  CHECK(bthome_host::controller_scanning(), "no scan after reset and sync");
+  CHECK(bthome_host::controller_accept_list_writes() == writes, "accept list retried after it failed");
+}
+
+static void test_reprogrammed_after_reset() {
+  Node node = make_node(2, true);
+  sync(node);
+  uint32_t writes = bthome_host::controller_accept_list_writes();
+
+  bthome_host::controller_reset(0);  // The controller forgets the list
+  node.hub->loop();
+  CHECK(!bthome_host::controller_scanning(), "scan restarted before the host synced again");
+  sync(node);
+  CHECK(bthome_host::controller_scanning(), "no scan after reset and sync");
+  CHECK(bthome_host::controller_accept_list_writes() == writes + 1, "accept list not re-programmed after reset");
+  CHECK(bthome_host::controller_accept_list_size() == 4, "accept list holds %zu entries, expected 4",
+        bthome_host::controller_accept_list_size());
+  CHECK(bthome_host::controller_scan_params().filter_policy == BLE_HCI_SCAN_FILT_USE_WL,
+        "scan after reset does not use the accept list");
+}
+
+static void test_restart_after_scan_complete() {
+  Node node = make_node(2, true);
+  sync(node);
+  uint32_t starts = bthome_host::controller_scan_starts();
+  uint32_t writes = bthome_host::controller_accept_list_writes();
+
+  bthome_host::controller_complete_scan();
+  CHECK(!bthome_host::controller_scanning(), "scan still running after DISC_COMPLETE");
+  node.hub->loop();
+  CHECK(bthome_host::controller_scanning(), "loop() did not restart the scan after DISC_COMPLETE");
+  CHECK(bthome_host::controller_scan_starts() == starts + 1, "scan started %u times, expected once",
+        bthome_host::controller_scan_starts() - starts);
+  // The controller still holds the list; it is not rewritten
+  CHECK(bthome_host::controller_accept_list_writes() == writes, "accept list rewritten after DISC_COMPLETE");
+}
+
+// Discovery logging needs to hear unconfigured senders, so it keeps the list off
+static void test_dump_mode_scans_unlisted() {
+  bthome_host::controller_reset_state();
+  auto *hub = new BTHomeReceiverHub();
+  hub->set_controller_filter(true);
+  hub->set_dump_interval(60000);
+  auto *device = new BTHomeDevice(hub);
+  device->set_mac_address(mac_of(address_of(0)));
+  hub->register_device(device);
+  hub->setup();
+  hub->loop();
+  bthome_host::controller_sync();
+  hub->loop();
+  CHECK(bthome_host::controller_scan_params().filter_policy == BLE_HCI_SCAN_FILT_NO_WL,
+        "dump mode scans with the accept list");
+  CHECK(bthome_host::controller_accept_list_writes() == 0, "dump mode programmed the accept list");
+}
+
+int main() {
+  test_accept_list_programmed_from_loop();
+  test_unlisted_senders_filtered();
+  test_reports_with_and_without_filter();
+  test_fallback_when_list_does_not_fit();
+  test_reprogrammed_after_reset();
+  test_restart_after_scan_complete();
+  test_dump_mode_scans_unlisted();
+  return bthome_test::finish("controller_filter");
+}
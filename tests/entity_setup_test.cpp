@@ -0,0 +1,132 @@
+// Heap allocations during entity setup in bthome_receiver (make test). The sensor platforms hand
+// each device a static array per entity kind, so registering entities must not allocate. A
+// counting global operator new measures it for the weather station in weather_display_t5_47.yaml,
+// next to the per-entity new + std::vector registration that the static tables replaced.
+
+#include "test_util.h"
+
+#include "components/bthome_receiver/bthome_receiver.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+using namespace esphome;
+using bthome_receiver::BTHomeDevice;
+using bthome_receiver::BTHomeReceiverHub;
+
+static bool counting = false;
+static uint32_t allocations = 0;
+
+// Out of line, so g++ does not pair the inlined malloc() and free() with new and delete
+__attribute__((noinline)) void *operator new(size_t size) {
+  if (counting) {
+    allocations++;
+  }
+  void *p = malloc(size ? size : 1);
+  if (p == nullptr) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+__attribute__((noinline)) void operator delete(void *p) noexcept { free(p); }
+__attribute__((noinline)) void operator delete(void *p, size_t) noexcept { free(p); }
+
+// Allocations made by body()
+template<typename Body> static uint32_t count_allocations(Body &&body) {
+  allocations = 0;
+  counting = true;
+  body();
+  counting = false;
+  return allocations;
+}
+
+// The receiver sensors of the weather station, in YAML order: object ID and index
+struct Entry {
+  uint8_t object_id;
+  uint8_t index;
+};
+static const Entry WEATHER_STATION[] = {
+    {0x45, 0},  // temperature_01
+    {0x2E, 0},  // humidity_uint8
+    {0x5F, 0},  // precipitation
+    {0x44, 0},  // speed
+    {0x44, 1},  // speed (gusts)
+    {0x5E, 0},  // direction
+    {0x05, 0},  // illuminance
+    {0x01, 0},  // battery
+    {0x04, 0},  // pressure
+    {0x08, 0},  // dewpoint
+};
+static const uint16_t SENSOR_COUNT = sizeof(WEATHER_STATION) / sizeof(WEATHER_STATION[0]);
+
+static void test_sensor_setup_does_not_allocate() {
+  static sensor::Sensor sensors[SENSOR_COUNT];
+  static bthome_receiver::BTHomeSensor storage[SENSOR_COUNT];  // As the sensor platform emits it
+  auto *device = new BTHomeDevice(new BTHomeReceiverHub());
+  device->set_mac_address(0xA4C138000001ULL);
+
+  uint32_t count = count_allocations([&] {
+    device->set_sensor_storage(storage, SENSOR_COUNT);
+    for (uint16_t i = 0; i < SENSOR_COUNT; i++) {
+      device->add_sensor(WEATHER_STATION[i].object_id, WEATHER_STATION[i].index, &sensors[i]);
+    }
+  });
+  CHECK(count == 0, "registering %u sensors made %u allocations, expected 0", SENSOR_COUNT, count);
+
+  // The table dispatches like the old one: both speed indexes, and an object out of YAML order
+  const uint8_t service_data[] = {0x40, 0x00, 0x07,   // packet_id 7
+                                  0x45, 0xD7, 0x00,   // temperature_01 21.5 °C
+                                  0x44, 0x2C, 0x01,   // speed 3.00 m/s
+                                  0x44, 0xBC, 0x02,   // speed 7.00 m/s (gusts)
+                                  0x08, 0x84, 0x03};  // dewpoint 9.00 °C
+  CHECK(device->parse_advertisement(service_data, sizeof(service_data)), "weather station packet rejected");
+  CHECK(std::fabs(sensors[0].state - 21.5f) < 0.001f, "temperature_01 is %g, expected 21.5", sensors[0].state);
+  CHECK(std::fabs(sensors[3].state - 3.0f) < 0.001f, "speed is %g, expected 3", sensors[3].state);
+  CHECK(std::fabs(sensors[4].state - 7.0f) < 0.001f, "gusts are %g, expected 7", sensors[4].state);
+  CHECK(std::fabs(sensors[9].state - 9.0f) < 0.001f, "dewpoint is %g, expected 9", sensors[9].state);
+
+  // Past the emitted size, add_sensor() refuses instead of growing
+  static sensor::Sensor extra;
+  count = count_allocations([&] { device->add_sensor(0x02, 0, &extra); });
+  CHECK(count == 0, "add_sensor() beyond the storage made %u allocations", count);
+
+  // The registration the static tables replaced: one new per entity, pushed into a growing vector
+  count = count_allocations([&] {
+    std::vector<bthome_receiver::BTHomeSensor *> table;
+    for (uint16_t i = 0; i < SENSOR_COUNT; i++) {
+      table.push_back(new bthome_receiver::BTHomeSensor(WEATHER_STATION[i].object_id, WEATHER_STATION[i].index,
+                                                        &sensors[i]));
+    }
+    for (auto *entity : table) {
+      delete entity;
+    }
+  });
+  printf("entity_setup: %u sensors, 0 allocations registering into static storage, %u with new + std::vector\n",
+         SENSOR_COUNT, count);
+}
+
+static void test_binary_and_text_setup_does_not_allocate() {
+  static binary_sensor::BinarySensor contact, motion;
+  static text_sensor::TextSensor label;
+  static bthome_receiver::BTHomeBinarySensor binary_storage[2];
+  static bthome_receiver::BTHomeTextSensor text_storage[1];
+  auto *device = new BTHomeDevice(new BTHomeReceiverHub());
+  device->set_mac_address(0xA4C138000002ULL);
+
+  uint32_t count = count_allocations([&] {
+    device->set_binary_sensor_storage(binary_storage, 2);
+    device->set_text_sensor_storage(text_storage, 1);
+    device->add_binary_sensor(0x21, &motion);
+    device->add_binary_sensor(0x11, &contact);
+    device->add_text_sensor(0x53, &label);
+  });
+  CHECK(count == 0, "registering binary and text sensors made %u allocations, expected 0", count);
+}
+
+int main() {
+  test_sensor_setup_does_not_allocate();
+  test_binary_and_text_setup_does_not_allocate();
+  return bthome_test::finish("entity_setup");
+}
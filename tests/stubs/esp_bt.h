@@ -0,0 +1,2 @@
+#pragma once
+typedef int esp_power_level_t;
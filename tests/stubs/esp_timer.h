@@ -0,0 +1,5 @@
+#pragma once
+#include <cstdint>
+
+// Host build: microseconds since the process started
+int64_t esp_timer_get_time();
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "esphome/core/component.h"
+
+#include <functional>
+
+namespace esphome {
+namespace binary_sensor {
+
+// Host build: keeps the last state and counts publishes
+class BinarySensor {
+ public:
+  void publish_state(bool state) {
+    this->state = state;
+    this->has_state_ = true;
+    this->publishes_++;
+  }
+  bool has_state() const { return this->has_state_; }
+  void add_on_state_callback(std::function<void(bool)> &&callback) {}
+  uint32_t get_publishes() const { return this->publishes_; }
+
+  bool state{false};
+
+ protected:
+  bool has_state_{false};
+  uint32_t publishes_{0};
+};
+
+}  // namespace binary_sensor
+}  // namespace esphome
@@ -0,0 +1,3 @@
+#pragma once
+// Host build: ESPHome copies external components into esphome/components/, forward to the repo
+#include "../../../../../components/bthome_codec/bthome_codec.h"
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "esphome/core/component.h"
+
+#include <cmath>
+#include <functional>
+
+namespace esphome {
+namespace sensor {
+
+// Host build: keeps the last state and counts publishes
+class Sensor {
+ public:
+  void publish_state(float state) {
+    this->state = state;
+    this->has_state_ = true;
+    this->publishes_++;
+  }
+  bool has_state() const { return this->has_state_; }
+  float get_raw_state() const { return this->state; }
+  void add_on_state_callback(std::function<void(float)> &&callback) {}
+  uint32_t get_publishes() const { return this->publishes_; }
+
+  float state{NAN};
+
+ protected:
+  bool has_state_{false};
+  uint32_t publishes_{0};
+};
+
+}  // namespace sensor
+}  // namespace esphome
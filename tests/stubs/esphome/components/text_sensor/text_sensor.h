@@ -0,0 +1,19 @@
+#pragma once
+
+#include "esphome/core/component.h"
+
+#include <string>
+
+namespace esphome {
+namespace text_sensor {
+
+// Host build: keeps the last state
+class TextSensor {
+ public:
+  void publish_state(const std::string &state) { this->state = state; }
+
+  std::string state;
+};
+
+}  // namespace text_sensor
+}  // namespace esphome
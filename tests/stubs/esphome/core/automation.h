@@ -0,0 +1,19 @@
+#pragma once
+
+#include "esphome/core/component.h"
+
+#include <cstdint>
+
+namespace esphome {
+
+// Host build: triggers only count how often they fired
+template<typename... Ts> class Trigger {
+ public:
+  void trigger(Ts... x) { this->fired_++; }
+  uint32_t get_fired() const { return this->fired_; }
+
+ protected:
+  uint32_t fired_{0};
+};
+
+}  // namespace esphome
@@ -0,0 +1,6 @@
+#pragma once
+// Host build: the platforms a full node config would enable. Component flags (USE_BTHOME_*,
+// BTHOME_MAX_*) come from the Makefile, like ESPHome's generated defines.
+#define USE_SENSOR
+#define USE_BINARY_SENSOR
+#define USE_TEXT_SENSOR
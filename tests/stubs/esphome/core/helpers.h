@@ -0,0 +1,52 @@
+#pragma once
+// Host build: the subset of esphome/core/helpers.h used by the BTHome components
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+
+namespace esphome {
+
+template<typename T, size_t N> class StaticVector {
+ public:
+  void push_back(const T &value) {
+    if (this->count_ < N)
+      this->data_[this->count_++] = value;
+  }
+  size_t size() const { return this->count_; }
+  bool empty() const { return this->count_ == 0; }
+  T &operator[](size_t i) { return this->data_[i]; }
+  const T &operator[](size_t i) const { return this->data_[i]; }
+  T *begin() { return this->data_.data(); }
+  T *end() { return this->data_.data() + this->count_; }
+  const T *begin() const { return this->data_.data(); }
+  const T *end() const { return this->data_.data() + this->count_; }
+
+ private:
+  std::array<T, N> data_{};
+  size_t count_{0};
+};
+
+template<typename T> class Parented {
+ public:
+  Parented() {}
+  Parented(T *parent) : parent_(parent) {}
+  T *get_parent() const { return this->parent_; }
+  void set_parent(T *parent) { this->parent_ = parent; }
+
+ protected:
+  T *parent_{nullptr};
+};
+
+// Plain heap allocation; internal RAM vs PSRAM makes no difference on the host
+template<class T> class RAMAllocator {
+ public:
+  enum : uint8_t { NONE = 0, ALLOC_EXTERNAL = 1 << 0, ALLOC_INTERNAL = 1 << 1 };
+  RAMAllocator(uint8_t flags = 0) {}
+  T *allocate(size_t n) { return static_cast<T *>(calloc(n, sizeof(T))); }
+  void deallocate(T *p, size_t n) { free(p); }
+};
+
+}  // namespace esphome
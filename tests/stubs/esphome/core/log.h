@@ -0,0 +1,19 @@
+#pragma once
+// Host build: logging compiles away, so benchmarks time the code and not printf. The arguments
+// still go through an unevaluated printf(), so they count as used and the format is checked.
+#include <cstdio>
+
+#define ESP_HOST_LOG_DISCARD(...) \
+  do { \
+    (void) sizeof(printf(__VA_ARGS__)); \
+  } while (0)
+#define ESP_LOGE(tag, ...) ESP_HOST_LOG_DISCARD(__VA_ARGS__)
+#define ESP_LOGW(tag, ...) ESP_HOST_LOG_DISCARD(__VA_ARGS__)
+#define ESP_LOGI(tag, ...) ESP_HOST_LOG_DISCARD(__VA_ARGS__)
+#define ESP_LOGD(tag, ...) ESP_HOST_LOG_DISCARD(__VA_ARGS__)
+#define ESP_LOGV(tag, ...) ESP_HOST_LOG_DISCARD(__VA_ARGS__)
+#define ESP_LOGVV(tag, ...) ESP_HOST_LOG_DISCARD(__VA_ARGS__)
+#define ESP_LOGCONFIG(tag, ...) ESP_HOST_LOG_DISCARD(__VA_ARGS__)
+#define LOG_SENSOR(prefix, type, obj) ESP_HOST_LOG_DISCARD("%p", (void *) (obj))
+#define LOG_BINARY_SENSOR(prefix, type, obj) ESP_HOST_LOG_DISCARD("%p", (void *) (obj))
+#define LOG_TEXT_SENSOR(prefix, type, obj) ESP_HOST_LOG_DISCARD("%p", (void *) (obj))
@@ -0,0 +1,3 @@
+#pragma once
+#define ESPHOME_VERSION "host"
+#define ESPHOME_VERSION_CODE 0
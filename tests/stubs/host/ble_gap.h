@@ -0,0 +1,72 @@
+#pragma once
+// Host build: the NimBLE GAP API used by the BTHome components, served by the stand-in controller
+
+#include <cstdint>
+
+#define BLE_ADDR_PUBLIC 0
+#define BLE_ADDR_RANDOM 1
+
+typedef struct {
+  uint8_t type;
+  uint8_t val[6];
+} ble_addr_t;
+
+struct ble_gap_disc_desc {
+  uint8_t event_type;
+  uint8_t length_data;
+  ble_addr_t addr;
+  int8_t rssi;
+  const uint8_t *data;
+  ble_addr_t direct_addr;
+};
+
+struct ble_gap_event {
+  uint8_t type;
+  union {
+    struct ble_gap_disc_desc disc;
+    struct {
+      int reason;
+    } disc_complete;
+  };
+};
+
+typedef int ble_gap_event_fn(struct ble_gap_event *event, void *arg);
+
+struct ble_gap_disc_params {
+  uint16_t itvl;
+  uint16_t window;
+  uint8_t filter_policy;
+  uint8_t limited : 1;
+  uint8_t passive : 1;
+  uint8_t filter_duplicates : 1;
+};
+
+struct ble_gap_adv_params {
+  uint8_t conn_mode;
+  uint8_t disc_mode;
+  uint16_t itvl_min;
+  uint16_t itvl_max;
+  uint8_t channel_map;
+  uint8_t filter_policy;
+  uint8_t high_duty_cycle : 1;
+};
+
+#define BLE_GAP_EVENT_DISC 7
+#define BLE_GAP_EVENT_DISC_COMPLETE 8
+#define BLE_GAP_EVENT_ADV_COMPLETE 9
+#define BLE_GAP_CONN_MODE_NON 0
+#define BLE_GAP_DISC_MODE_GEN 2
+#define BLE_HCI_SCAN_FILT_NO_WL 0
+#define BLE_HCI_SCAN_FILT_USE_WL 1
+
+int ble_gap_disc(uint8_t own_addr_type, int32_t duration_ms, const struct ble_gap_disc_params *disc_params,
+                 ble_gap_event_fn *cb, void *cb_arg);
+int ble_gap_disc_cancel(void);
+int ble_gap_disc_active(void);
+int ble_gap_wl_set(const ble_addr_t *addrs, uint8_t white_list_count);
+int ble_gap_adv_set_data(const uint8_t *data, int data_len);
+int ble_gap_adv_rsp_set_data(const uint8_t *data, int data_len);
+int ble_gap_adv_start(uint8_t own_addr_type, const ble_addr_t *direct_addr, int32_t duration_ms,
+                      const struct ble_gap_adv_params *adv_params, ble_gap_event_fn *cb, void *cb_arg);
+int ble_gap_adv_stop(void);
+int ble_gap_adv_active(void);
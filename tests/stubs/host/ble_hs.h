@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include "host/ble_gap.h"
+
+// Return codes as in NimBLE's ble_hs.h
+#define BLE_HS_EALREADY 2
+#define BLE_HS_EINVAL 3
+#define BLE_HS_ENOMEM 6
+#define BLE_HS_EBUSY 15
+
+#define BLE_HS_FOREVER INT32_MAX
+#define BLE_OWN_ADDR_PUBLIC 0
+
+typedef void ble_hs_reset_fn(int reason);
+typedef void ble_hs_sync_fn(void);
+
+struct ble_hs_cfg {
+  ble_hs_reset_fn *reset_cb;
+  ble_hs_sync_fn *sync_cb;
+};
+extern struct ble_hs_cfg ble_hs_cfg;
+
+int ble_hs_synced(void);
+int ble_hs_id_infer_auto(int privacy, uint8_t *out_addr_type);
+int ble_hs_id_copy_addr(uint8_t id_addr_type, uint8_t *out_id_addr, int *out_is_nrpa);
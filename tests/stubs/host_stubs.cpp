@@ -0,0 +1,429 @@
+// Host build: ESP-IDF, NimBLE and crypto functions the BTHome components call, implemented on
+// the host so bthome.cpp, bthome_receiver.cpp and nimble_host.cpp build and run unmodified.
+//
+// AES-CCM (mbedtls and tinycrypt APIs) is one implementation on OpenSSL's AES, so packets
+// encrypted by one component decrypt in the other. The GAP API is served by the stand-in controller (stand_in_controller.h).
+
+#include "stand_in_controller.h"
+
+#include "esp_err.h"
+#include "esp_timer.h"
+#include "esphome/components/bthome_nimble/nimble_host.h"
+#include "esphome/core/hal.h"
+#include "host/ble_gap.h"
+#include "host/ble_hs.h"
+#include "mbedtls/ccm.h"
+#include "nimble/nimble_port.h"
+#include "nimble/nimble_port_freertos.h"
+#include "nvs_flash.h"
+#include "tinycrypt/aes.h"
+#include "tinycrypt/ccm_mode.h"
+
+#include <openssl/evp.h>
+
+#include <chrono>
+#include <cstring>
+#include <set>
+#include <vector>
+
+// ============================================================================
+// ESP-IDF
+// ============================================================================
+
+static const auto PROCESS_START = std::chrono::steady_clock::now();
+
+int64_t esp_timer_get_time() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - PROCESS_START)
+      .count();
+}
+
+namespace esphome {
+uint32_t millis() { return esp_timer_get_time() / 1000; }
+uint32_t micros() { return esp_timer_get_time(); }
+}  // namespace esphome
+
+const char *esp_err_to_name(esp_err_t code) { return code == ESP_OK ? "ESP_OK" : "ESP_FAIL"; }
+esp_err_t nvs_flash_init() { return ESP_OK; }
+esp_err_t nvs_flash_erase() { return ESP_OK; }
+esp_err_t nimble_port_init() { return ESP_OK; }
+void nimble_port_run() {}
+int nimble_port_deinit() { return 0; }
+void nimble_port_freertos_init(void (*host_task)(void *)) {}
+void nimble_port_freertos_deinit() {}
+
+// ============================================================================
+// AES-128-CCM
+// ============================================================================
+
+// CCM (RFC 3610) over an AES-128-ECB context. The key is expanded once, when the context is
+// created, as mbedtls_ccm_setkey() and tc_aes128_set_encrypt_key() do on the node; every
+// operation after that only runs blocks through it.
+struct CcmCipher {
+  EVP_CIPHER_CTX *ecb;
+};
+
+static CcmCipher *new_ccm_cipher(const unsigned char *key) {
+  EVP_CIPHER_CTX *ecb = EVP_CIPHER_CTX_new();
+  if (ecb == nullptr || EVP_EncryptInit_ex(ecb, EVP_aes_128_ecb(), nullptr, key, nullptr) != 1) {
+    EVP_CIPHER_CTX_free(ecb);
+    return nullptr;
+  }
+  EVP_CIPHER_CTX_set_padding(ecb, 0);
+  return new CcmCipher{ecb};
+}
+
+static void free_ccm_cipher(void *context) {
+  auto *cipher = static_cast<CcmCipher *>(context);
+  if (cipher != nullptr) {
+    EVP_CIPHER_CTX_free(cipher->ecb);
+    delete cipher;
+  }
+}
+
+static void aes_block(CcmCipher *cipher, const uint8_t in[16], uint8_t out[16]) {
+  int out_len;
+  EVP_EncryptUpdate(cipher->ecb, out, &out_len, in, 16);
+}
+
+// Big-endian value in the last l bytes of a 16-byte block
+static void set_block_counter(uint8_t block[16], size_t l, size_t value) {
+  for (size_t i = 0; i < l; i++) {
+    block[15 - i] = static_cast<uint8_t>(value >> (i * 8));
+  }
+}
+
+// One CCM operation without associated data. tag is read when decrypting and written when
+// encrypting.
+static bool ccm_crypt(void *context, bool encrypt, size_t length, const unsigned char *nonce, size_t nonce_len,
+                      const unsigned char *input, unsigned char *output, unsigned char *tag, size_t tag_len) {
+  auto *cipher = static_cast<CcmCipher *>(context);
+  if (cipher == nullptr || nonce_len < 7 || nonce_len > 13 || tag_len < 4 || tag_len > 16 || (tag_len & 1) != 0) {
+    return false;
+  }
+  const size_t l = 15 - nonce_len;  // Bytes of the length and counter fields
+
+  // Counter blocks A_i: flags, nonce, i. A_0 masks the tag, A_1.. encrypt the data.
+  uint8_t ctr[16] = {0}, stream[16];
+  ctr[0] = l - 1;
+  memcpy(ctr + 1, nonce, nonce_len);
+  auto apply_ctr = [&](const uint8_t *in, uint8_t *out) {
+    for (size_t pos = 0, i = 1; pos < length; pos += 16, i++) {
+      set_block_counter(ctr, l, i);
+      aes_block(cipher, ctr, stream);
+      for (size_t k = 0; k < 16 && pos + k < length; k++) {
+        out[pos + k] = in[pos + k] ^ stream[k];
+      }
+    }
+  };
+
+  if (!encrypt) {
+    apply_ctr(input, output);
+  }
+  const uint8_t *plaintext = encrypt ? input : output;
+
+  // CBC-MAC over B_0 (flags, nonce, length) and the zero-padded plaintext
+  uint8_t mac[16] = {0};
+  mac[0] = static_cast<uint8_t>(((tag_len - 2) / 2) << 3 | (l - 1));
+  memcpy(mac + 1, nonce, nonce_len);
+  set_block_counter(mac, l, length);
+  aes_block(cipher, mac, mac);
+  for (size_t pos = 0; pos < length; pos += 16) {
+    for (size_t k = 0; k < 16 && pos + k < length; k++) {
+      mac[k] ^= plaintext[pos + k];
+    }
+    aes_block(cipher, mac, mac);
+  }
+
+  uint8_t tag_mask[16];
+  set_block_counter(ctr, l, 0);
+  aes_block(cipher, ctr, tag_mask);
+  if (encrypt) {
+    apply_ctr(input, output);
+    for (size_t k = 0; k < tag_len; k++) {
+      tag[k] = mac[k] ^ tag_mask[k];
+    }
+    return true;
+  }
+  uint8_t diff = 0;
+  for (size_t k = 0; k < tag_len; k++) {
+    diff |= tag[k] ^ mac[k] ^ tag_mask[k];
+  }
+  return diff == 0;
+}
+
+void mbedtls_ccm_init(mbedtls_ccm_context *ctx) { ctx->cipher = nullptr; }
+
+void mbedtls_ccm_free(mbedtls_ccm_context *ctx) {
+  free_ccm_cipher(ctx->cipher);
+  ctx->cipher = nullptr;
+}
+
+int mbedtls_ccm_setkey(mbedtls_ccm_context *ctx, int cipher, const unsigned char *key, unsigned int keybits) {
+  if (cipher != MBEDTLS_CIPHER_ID_AES || keybits != 128) {
+    return MBEDTLS_ERR_CCM_BAD_INPUT;
+  }
+  mbedtls_ccm_free(ctx);
+  ctx->cipher = new_ccm_cipher(key);
+  return ctx->cipher != nullptr ? 0 : MBEDTLS_ERR_CCM_BAD_INPUT;
+}
+
+int mbedtls_ccm_encrypt_and_tag(mbedtls_ccm_context *ctx, size_t length, const unsigned char *iv, size_t iv_len,
+                                const unsigned char *ad, size_t ad_len, const unsigned char *input,
+                                unsigned char *output, unsigned char *tag, size_t tag_len) {
+  if (ad_len != 0) {
+    return MBEDTLS_ERR_CCM_BAD_INPUT;  // BTHome uses no associated data
+  }
+  return ccm_crypt(ctx->cipher, true, length, iv, iv_len, input, output, tag, tag_len) ? 0
+                                                                                       : MBEDTLS_ERR_CCM_BAD_INPUT;
+}
+
+int mbedtls_ccm_auth_decrypt(mbedtls_ccm_context *ctx, size_t length, const unsigned char *iv, size_t iv_len,
+                             const unsigned char *ad, size_t ad_len, const unsigned char *input,
+                             unsigned char *output, const unsigned char *tag, size_t tag_len) {
+  if (ad_len != 0) {
+    return MBEDTLS_ERR_CCM_BAD_INPUT;
+  }
+  unsigned char expected[16];
+  memcpy(expected, tag, tag_len);
+  return ccm_crypt(ctx->cipher, false, length, iv, iv_len, input, output, expected, tag_len)
+             ? 0
+             : MBEDTLS_ERR_CCM_AUTH_FAILED;
+}
+
+int tc_aes128_set_encrypt_key(TCAesKeySched_t s, const uint8_t *k) {
+  memcpy(s->words, k, 16);
+  s->cipher = new_ccm_cipher(k);
+  return s->cipher != nullptr ? TC_CRYPTO_SUCCESS : TC_CRYPTO_FAIL;
+}
+
+int tc_ccm_config(TCCcmMode_t c, TCAesKeySched_t sched, uint8_t *nonce, unsigned int nlen, unsigned int mlen) {
+  if (nlen != 13 || mlen < 4 || mlen > 16 || (mlen & 1) != 0) {
+    return TC_CRYPTO_FAIL;
+  }
+  c->sched = sched;
+  c->nonce = nonce;
+  c->mlen = mlen;
+  return TC_CRYPTO_SUCCESS;
+}
+
+int tc_ccm_generation_encryption(uint8_t *out, unsigned int olen, const uint8_t *associated_data, unsigned int alen,
+                                 const uint8_t *payload, unsigned int plen, TCCcmMode_t c) {
+  if (alen != 0 || olen < plen + c->mlen) {
+    return TC_CRYPTO_FAIL;
+  }
+  return ccm_crypt(c->sched->cipher, true, plen, c->nonce, 13, payload, out, out + plen, c->mlen) ? TC_CRYPTO_SUCCESS
+                                                                                                  : TC_CRYPTO_FAIL;
+}
+
+// ============================================================================
+// Stand-in controller and NimBLE host
+// ============================================================================
+
+struct ble_hs_cfg ble_hs_cfg;
+
+namespace bthome_host {
+
+// Reaches the shared host's registration state, which has no reset outside tests
+struct NimBLEHostAccess : esphome::bthome_nimble::NimBLEHost {
+  static void reset() {
+    listeners_.clear();
+    started_ = false;
+    start_failed_ = false;
+    synced_.store(false);
+    advertising_.store(false);
+  }
+};
+
+struct Controller {
+  uint8_t address[6]{0x01, 0x00, 0x00, 0xC1, 0xC4, 0xA4};
+  bool synced{false};
+  size_t accept_list_capacity{12};  // ESP32 controller default
+  std::vector<ble_addr_t> accept_list;
+
+  bool scanning{false};
+  ble_gap_disc_params scan_params{};
+  ble_gap_event_fn *scan_cb{nullptr};
+  void *scan_cb_arg{nullptr};
+  std::set<std::vector<uint8_t>> duplicates;  // Address, type and data seen since the scan started
+
+  bool advertising{false};
+
+  uint32_t delivered{0};
+  uint32_t filtered{0};
+  uint32_t scan_starts{0};
+  uint32_t accept_list_writes{0};
+};
+static Controller controller;
+
+void controller_reset_state() {
+  controller = Controller();
+  ble_hs_cfg = {};
+  NimBLEHostAccess::reset();
+}
+
+void controller_set_address(const uint8_t address[6]) { memcpy(controller.address, address, 6); }
+void controller_set_accept_list_capacity(size_t capacity) { controller.accept_list_capacity = capacity; }
+
+void controller_sync() {
+  controller.synced = true;
+  if (ble_hs_cfg.sync_cb != nullptr) {
+    ble_hs_cfg.sync_cb();
+  }
+}
+
+void controller_reset(int reason) {
+  // A host reset stops every GAP procedure and the controller forgets its accept list
+  controller.synced = false;
+  controller.scanning = false;
+  controller.advertising = false;
+  controller.accept_list.clear();
+  if (ble_hs_cfg.reset_cb != nullptr) {
+    ble_hs_cfg.reset_cb(reason);
+  }
+}
+
+void controller_complete_scan() {
+  if (!controller.scanning) {
+    return;
+  }
+  controller.scanning = false;
+  ble_gap_event event{};
+  event.type = BLE_GAP_EVENT_DISC_COMPLETE;
+  controller.scan_cb(&event, controller.scan_cb_arg);
+}
+
+static bool on_accept_list(const uint8_t address[6], uint8_t address_type) {
+  for (const auto &entry : controller.accept_list) {
+    if (entry.type == address_type && memcmp(entry.val, address, 6) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool controller_advertise(const uint8_t address[6], uint8_t address_type, const uint8_t *data, uint8_t len,
+                          int8_t rssi) {
+  if (!controller.scanning) {
+    return false;
+  }
+  if (controller.scan_params.filter_policy == BLE_HCI_SCAN_FILT_USE_WL && !on_accept_list(address, address_type)) {
+    controller.filtered++;
+    return false;
+  }
+  if (controller.scan_params.filter_duplicates) {
+    // Filtered by address and data, as the receiver configures the ESP32 controller
+    std::vector<uint8_t> key(address, address + 6);
+    key.push_back(address_type);
+    key.insert(key.end(), data, data + len);
+    if (!controller.duplicates.insert(key).second) {
+      controller.filtered++;
+      return false;
+    }
+  }
+
+  ble_gap_event event{};
+  event.type = BLE_GAP_EVENT_DISC;
+  event.disc.length_data = len;
+  event.disc.data = data;
+  event.disc.rssi = rssi;
+  event.disc.addr.type = address_type;
+  memcpy(event.disc.addr.val, address, 6);
+  controller.delivered++;
+  controller.scan_cb(&event, controller.scan_cb_arg);
+  return true;
+}
+
+bool controller_scanning() { return controller.scanning; }
+const ble_gap_disc_params &controller_scan_params() { return controller.scan_params; }
+size_t controller_accept_list_size() { return controller.accept_list.size(); }
+uint32_t controller_reports_delivered() { return controller.delivered; }
+uint32_t controller_reports_filtered() { return controller.filtered; }
+uint32_t controller_scan_starts() { return controller.scan_starts; }
+uint32_t controller_accept_list_writes() { return controller.accept_list_writes; }
+
+}  // namespace bthome_host
+
+using bthome_host::controller;
+
+int ble_hs_synced(void) { return controller.synced; }
+
+int ble_hs_id_infer_auto(int privacy, uint8_t *out_addr_type) {
+  *out_addr_type = BLE_OWN_ADDR_PUBLIC;
+  return controller.synced ? 0 : BLE_HS_EINVAL;
+}
+
+int ble_hs_id_copy_addr(uint8_t id_addr_type, uint8_t *out_id_addr, int *out_is_nrpa) {
+  memcpy(out_id_addr, controller.address, 6);
+  if (out_is_nrpa != nullptr) {
+    *out_is_nrpa = 0;
+  }
+  return 0;
+}
+
+int ble_gap_disc(uint8_t own_addr_type, int32_t duration_ms, const struct ble_gap_disc_params *disc_params,
+                 ble_gap_event_fn *cb, void *cb_arg) {
+  if (!controller.synced) {
+    return BLE_HS_EINVAL;
+  }
+  if (controller.scanning) {
+    return BLE_HS_EALREADY;
+  }
+  if (disc_params->window > disc_params->itvl) {
+    return BLE_HS_EINVAL;
+  }
+  controller.scanning = true;
+  controller.scan_params = *disc_params;
+  controller.scan_cb = cb;
+  controller.scan_cb_arg = cb_arg;
+  controller.duplicates.clear();
+  controller.scan_starts++;
+  return 0;
+}
+
+int ble_gap_disc_cancel(void) {
+  if (!controller.scanning) {
+    return BLE_HS_EALREADY;
+  }
+  controller.scanning = false;  // Cancelling reports no DISC_COMPLETE, as in NimBLE
+  return 0;
+}
+
+int ble_gap_disc_active(void) { return controller.scanning; }
+
+int ble_gap_wl_set(const ble_addr_t *addrs, uint8_t white_list_count) {
+  controller.accept_list_writes++;
+  // The controller rejects accept list changes while a scan is using it
+  if (controller.scanning && controller.scan_params.filter_policy == BLE_HCI_SCAN_FILT_USE_WL) {
+    return BLE_HS_EBUSY;
+  }
+  if (white_list_count > controller.accept_list_capacity) {
+    return BLE_HS_ENOMEM;
+  }
+  controller.accept_list.assign(addrs, addrs + white_list_count);
+  return 0;
+}
+
+int ble_gap_adv_set_data(const uint8_t *data, int data_len) { return data_len <= 31 ? 0 : BLE_HS_EINVAL; }
+int ble_gap_adv_rsp_set_data(const uint8_t *data, int data_len) { return data_len <= 31 ? 0 : BLE_HS_EINVAL; }
+
+int ble_gap_adv_start(uint8_t own_addr_type, const ble_addr_t *direct_addr, int32_t duration_ms,
+                      const struct ble_gap_adv_params *adv_params, ble_gap_event_fn *cb, void *cb_arg) {
+  if (!controller.synced) {
+    return BLE_HS_EINVAL;
+  }
+  if (controller.advertising) {
+    return BLE_HS_EALREADY;
+  }
+  controller.advertising = true;
+  return 0;
+}
+
+int ble_gap_adv_stop(void) {
+  if (!controller.advertising) {
+    return BLE_HS_EALREADY;
+  }
+  controller.advertising = false;
+  return 0;
+}
+
+int ble_gap_adv_active(void) { return controller.advertising; }
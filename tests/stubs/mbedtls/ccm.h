@@ -0,0 +1,23 @@
+#pragma once
+// Host build: mbedtls CCM API over OpenSSL's AES-128-CCM (tests/stubs/host_stubs.cpp)
+
+#include <cstddef>
+
+#define MBEDTLS_CIPHER_ID_AES 2
+#define MBEDTLS_ERR_CCM_BAD_INPUT -0x000D
+#define MBEDTLS_ERR_CCM_AUTH_FAILED -0x000F
+
+// Like mbedtls, the context owns a cipher context allocated by mbedtls_ccm_setkey()
+typedef struct mbedtls_ccm_context {
+  void *cipher;
+} mbedtls_ccm_context;
+
+void mbedtls_ccm_init(mbedtls_ccm_context *ctx);
+void mbedtls_ccm_free(mbedtls_ccm_context *ctx);
+int mbedtls_ccm_setkey(mbedtls_ccm_context *ctx, int cipher, const unsigned char *key, unsigned int keybits);
+int mbedtls_ccm_encrypt_and_tag(mbedtls_ccm_context *ctx, size_t length, const unsigned char *iv, size_t iv_len,
+                                const unsigned char *ad, size_t ad_len, const unsigned char *input,
+                                unsigned char *output, unsigned char *tag, size_t tag_len);
+int mbedtls_ccm_auth_decrypt(mbedtls_ccm_context *ctx, size_t length, const unsigned char *iv, size_t iv_len,
+                             const unsigned char *ad, size_t ad_len, const unsigned char *input,
+                             unsigned char *output, const unsigned char *tag, size_t tag_len);
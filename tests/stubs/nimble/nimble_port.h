@@ -0,0 +1,5 @@
+#pragma once
+#include "esp_err.h"
+esp_err_t nimble_port_init();
+void nimble_port_run();
+int nimble_port_deinit();
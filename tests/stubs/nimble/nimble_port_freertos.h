@@ -0,0 +1,4 @@
+#pragma once
+// Host build: no host task is started, tests drive the host callbacks (see stand_in_controller.h)
+void nimble_port_freertos_init(void (*host_task)(void *));
+void nimble_port_freertos_deinit();
@@ -0,0 +1,44 @@
+#pragma once
+// Host build: a stand-in for the BLE controller and the NimBLE host task.
+//
+// The components talk to it through the NimBLE GAP API stubs. Tests play the radio and the host
+// task: they deliver advertising reports, which the controller filters the way the scan asked
+// for (accept list, duplicate filter) before calling the scan's GAP callback, and they fire the
+// host sync/reset callbacks. Everything runs on the calling thread.
+
+#include <cstddef>
+#include <cstdint>
+
+#include "host/ble_hs.h"
+
+namespace bthome_host {
+
+// Forget scans, accept list, advertising and counters, and detach the shared NimBLE host's
+// listeners, so a test can set up fresh components
+void controller_reset_state();
+
+// The node's own public address (little-endian, as NimBLE reports it)
+void controller_set_address(const uint8_t address[6]);
+// Entries the controller's accept list holds; ble_gap_wl_set() fails beyond this
+void controller_set_accept_list_capacity(size_t capacity);
+
+// Host task events: run ble_hs_cfg.sync_cb / reset_cb like the host task would
+void controller_sync();
+void controller_reset(int reason);
+// End the running scan as if its duration expired (BLE_GAP_EVENT_DISC_COMPLETE)
+void controller_complete_scan();
+
+// Deliver one advertising report (address little-endian). Returns true if it passed the scan's
+// filters and reached the GAP callback.
+bool controller_advertise(const uint8_t address[6], uint8_t address_type, const uint8_t *data, uint8_t len,
+                          int8_t rssi = -60);
+
+bool controller_scanning();
+const ble_gap_disc_params &controller_scan_params();
+size_t controller_accept_list_size();
+uint32_t controller_reports_delivered();  // Reached the GAP callback
+uint32_t controller_reports_filtered();   // Dropped by the accept list or the duplicate filter
+uint32_t controller_scan_starts();
+uint32_t controller_accept_list_writes();  // ble_gap_wl_set() calls, failed ones included
+
+}  // namespace bthome_host
@@ -0,0 +1,14 @@
+#pragma once
+// Host build: tinycrypt AES API over OpenSSL (tests/stubs/host_stubs.cpp)
+
+#include <cstdint>
+#include "tinycrypt/constants.h"
+
+// The expanded key lives in an OpenSSL cipher context instead of the round key words
+struct tc_aes_key_sched_struct {
+  unsigned int words[44];
+  void *cipher;
+};
+typedef struct tc_aes_key_sched_struct *TCAesKeySched_t;
+
+int tc_aes128_set_encrypt_key(TCAesKeySched_t s, const uint8_t *k);
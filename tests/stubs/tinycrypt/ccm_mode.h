@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstddef>
+#include "tinycrypt/aes.h"
+
+struct tc_ccm_mode_struct {
+  TCAesKeySched_t sched;
+  uint8_t *nonce;
+  unsigned int mlen;
+};
+typedef struct tc_ccm_mode_struct *TCCcmMode_t;
+
+int tc_ccm_config(TCCcmMode_t c, TCAesKeySched_t sched, uint8_t *nonce, unsigned int nlen, unsigned int mlen);
+int tc_ccm_generation_encryption(uint8_t *out, unsigned int olen, const uint8_t *associated_data, unsigned int alen,
+                                 const uint8_t *payload, unsigned int plen, TCCcmMode_t c);
@@ -0,0 +1,3 @@
+#pragma once
+#define TC_CRYPTO_SUCCESS 1
+#define TC_CRYPTO_FAIL 0
@@ -0,0 +1,30 @@
+#pragma once
+// Host test helpers: CHECK() records a failure with its location and keeps going, so one run
+// reports every broken case; finish() prints the verdict and gives main() its exit code.
+
+#include <cstdio>
+
+namespace bthome_test {
+
+inline int failures = 0;
+
+inline int finish(const char *suite) {
+  if (failures > 0) {
+    fprintf(stderr, "%s: %d failure(s)\n", suite, failures);
+    return 1;
+  }
+  printf("%s: OK\n", suite);
+  return 0;
+}
+
+}  // namespace bthome_test
+
+#define CHECK(cond, ...) \
+  do { \
+    if (!(cond)) { \
+      fprintf(stderr, "%s:%d: ", __FILE__, __LINE__); \
+      fprintf(stderr, __VA_ARGS__); \
+      fprintf(stderr, "\n"); \
+      bthome_test::failures++; \
+    } \
+  } while (0)